@@ -7,24 +7,25 @@
 class AngleCalculation {
 public:
   void configure(
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       int bxWindow,
       int thetaWindow, int thetaWindowZone0,
       bool bugME11Dupes, bool bugAmbigThetaWin, bool twoStationSameBX
   );
 
   void process(
+      int bx,
       emtf::zone_array<EMTFTrackCollection>& zone_tracks
   ) const;
 
   void calculate_angles(EMTFTrack& track, const int izone) const;
 
-  void calculate_bx(EMTFTrack& track) const;
+  void calculate_bx(EMTFTrack& track, int bx) const;
 
   void erase_tracks(EMTFTrackCollection& tracks) const;
 
 private:
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
 
   int bxWindow_;
   int thetaWindow_, thetaWindowZone0_;
@@ -0,0 +1,97 @@
+#ifndef L1TMuonEndCap_BXWindow_h
+#define L1TMuonEndCap_BXWindow_h
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+
+// Class declaration
+// - Objects of the last bxWindow BXs of one sector processor, ordered from
+//   the earliest to the latest BX.
+// - The slots are allocated once in configure() and used as a ring buffer.
+//   A slot is not cleared when it is reused, so that its content keeps the
+//   capacity from earlier BXs and events; the caller resets it.
+template<typename T>
+class BXWindow {
+public:
+  BXWindow() : first_(0), size_(0) {}
+
+  void configure(int capacity) {
+    assert(capacity > 0);
+    slots_.resize(capacity);
+    clear();
+  }
+
+  void clear() {
+    first_ = 0;
+    size_ = 0;
+  }
+
+  int capacity() const { return slots_.size(); }
+
+  int size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  // Open the slot for a new BX after the latest one
+  T& push_back() {
+    assert(size_ < capacity());
+    T& slot = slots_[index(size_)];
+    ++size_;
+    return slot;
+  }
+
+  // Drop the earliest BX
+  void pop_front() {
+    assert(size_ > 0);
+    first_ = index(1);
+    --size_;
+  }
+
+  // i = 0 is the earliest BX
+  T& at(int i) {
+    assert(0 <= i && i < size_);
+    return slots_[index(i)];
+  }
+
+  const T& at(int i) const {
+    assert(0 <= i && i < size_);
+    return slots_[index(i)];
+  }
+
+  // h = 0 is the latest BX, h = 1 the BX before that, and so on
+  const T& latest(int h) const { return at(size_ - 1 - h); }
+
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef int difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator(const BXWindow* window, int i) : window_(window), i_(i) {}
+    const T& operator*() const { return window_->at(i_); }
+    const T* operator->() const { return &window_->at(i_); }
+    const_iterator& operator++() { ++i_; return *this; }
+    bool operator==(const const_iterator& other) const { return i_ == other.i_; }
+    bool operator!=(const const_iterator& other) const { return i_ != other.i_; }
+  private:
+    const BXWindow* window_;
+    int i_;
+  };
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  const_iterator end() const { return const_iterator(this, size_); }
+
+private:
+  int index(int i) const { return (first_ + i) % capacity(); }
+
+  std::vector<T> slots_;
+
+  int first_, size_;
+};
+
+#endif
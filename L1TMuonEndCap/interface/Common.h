@@ -64,6 +64,11 @@ namespace emtf {
   constexpr int NUM_STATIONS = 4;
   constexpr int NUM_STATION_PAIRS = 6;
 
+  // Input links, see PrimitiveSelection. The RPC range is the largest,
+  // before RPC chambers are mapped onto CSC chambers
+  constexpr int NUM_LINKS = 7*10;
+  constexpr int NUM_LINK_HITS = 4;  // 2 LCTs per chamber, 4 after theta duplication
+
   // Fixed-size arrays
   template<typename T>
   using sector_array = std::array<T, NUM_SECTORS>;
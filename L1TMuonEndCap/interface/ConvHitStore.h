@@ -0,0 +1,66 @@
+#ifndef L1TMuonEndCap_ConvHitStore_h
+#define L1TMuonEndCap_ConvHitStore_h
+
+#include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+#include "L1Trigger/L1TMuonEndCap/interface/BXWindow.h"
+
+
+// Class declaration
+// - Compact copy of the converted hits in the BX window, for the use of
+//   pattern recognition and primitive matching. Every field is stored in its
+//   own array, grouped by zone for the zone images and by (zone, station) for
+//   the matching, so that the inner loops do not read the full EMTFHit.
+// - The EMTFHit itself is only referenced, and is copied when it is inserted
+//   into a track. The references are valid until the BX window is modified.
+class ConvHitStore {
+public:
+  // Hits that form the zone image of one zone, decided by the zone code.
+  // RPC and GEM hits are not used for pattern formation.
+  struct ZoneHits {
+    std::vector<int> layer;
+    std::vector<int> zone_hit;
+
+    int size() const { return layer.size(); }
+    bool empty() const { return layer.empty(); }
+  };
+
+  // Hits of one (zone, station) for the matching, decided by the zone code
+  // as in the firmware find_segment module. fs_segment and bt_segment include
+  // the BX history relative to the processor BX.
+  struct ZoneStationHits {
+    std::vector<int> phi_fp;
+    std::vector<int> fs_segment;
+    std::vector<int> bt_segment;
+    std::vector<int> subsystem;
+    std::vector<const EMTFHit*> hit;
+
+    int size() const { return phi_fp.size(); }
+    bool empty() const { return phi_fp.empty(); }
+
+    // Copy of the hit with the BX history
+    EMTFHit materialize(int ihit) const;
+  };
+
+  ConvHitStore() : num_hits_(0) {}
+
+  void build(int bx, const BXWindow<EMTFHitCollection>& extended_conv_hits);
+
+  // Number of hits in the BX window
+  int num_hits() const { return num_hits_; }
+
+  // izone, istation are 0-based
+  const ZoneHits& zone_hits(int izone) const { return zone_hits_.at(izone); }
+
+  const ZoneStationHits& zone_station_hits(int izone, int istation) const {
+    return zs_hits_.at((izone * emtf::NUM_STATIONS) + istation);
+  }
+
+private:
+  int num_hits_;
+
+  emtf::zone_array<ZoneHits> zone_hits_;
+
+  std::array<ZoneStationHits, emtf::NUM_ZONES*emtf::NUM_STATIONS> zs_hits_;
+};
+
+#endif
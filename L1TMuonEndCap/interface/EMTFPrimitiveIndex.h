@@ -0,0 +1,71 @@
+#ifndef L1TMuonEndCap_EMTFPrimitiveIndex_h
+#define L1TMuonEndCap_EMTFPrimitiveIndex_h
+
+#include <vector>
+
+#include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+
+
+// Class declaration
+// - Index of the trigger primitives of one event, bucketed by (subsystem,
+//   sector, BX). It is built once per event right after the primitives are
+//   extracted by EMTFSubsystemCollector, so that PrimitiveSelection only needs
+//   to look at the candidates of its own sector and BX.
+// - A primitive is put into the bucket of every sector that can select it,
+//   i.e. its native sector and the sector that uses it as a neighbor. The
+//   buckets are therefore a superset of what PrimitiveSelection keeps; the
+//   full selection logic is still applied to each candidate.
+// - The candidates are stored as indices into the TriggerPrimitiveCollection,
+//   in the original order, so the firmware truncation ("keep the first N")
+//   is unchanged.
+// - A (sector, BX) occupancy bitmap over all subsystems is filled at the same
+//   time, so that a sector processor can skip the BXs without any candidate.
+class EMTFPrimitiveIndex {
+public:
+  typedef std::vector<unsigned> index_list_t;
+
+  explicit EMTFPrimitiveIndex();
+  ~EMTFPrimitiveIndex();
+
+  void configure(
+      int minBX, int maxBX,
+      int bxShiftCSC, int bxShiftRPC, int bxShiftGEM
+  );
+
+  // Change the range of BXs. Does nothing if the range is unchanged.
+  void set_bx_range(int minBX, int maxBX);
+
+  int get_min_bx() const { return minBX_; }
+  int get_max_bx() const { return maxBX_; }
+
+  // Also checks the format of each primitive, and warns about the primitives
+  // that are not used by any sector processor
+  void build(const TriggerPrimitiveCollection& muon_primitives);
+
+  // Returns the indices of the candidate primitives for a given subsystem, endcap, sector and BX
+  const index_list_t& get(int subsystem, int endcap, int sector, int bx) const;
+
+  // Returns true if any subsystem has candidate primitives for a given endcap, sector and BX.
+  // Outside of the BX range of the index, always returns true, so that nothing is skipped.
+  bool is_occupied(int endcap, int sector, int bx) const;
+
+private:
+  void resize();
+
+  // Returns false if there is no bucket for this subsystem, endcap, sector and BX
+  bool insert(int subsystem, int endcap, int sector, int bx, unsigned index);
+
+  int get_bucket(int subsystem, int endcap, int sector, int bx) const;
+
+  std::vector<index_list_t> buckets_;
+
+  emtf::sector_array<uint64_t> occupancy_;  // one bit per BX
+
+  index_list_t empty_;
+
+  int minBX_, maxBX_;
+
+  int bxShiftCSC_, bxShiftRPC_, bxShiftGEM_;
+};
+
+#endif
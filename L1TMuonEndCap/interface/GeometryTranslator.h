@@ -18,6 +18,9 @@
 #include "FWCore/Framework/interface/ESHandle.h"
 #include "DataFormats/GeometryVector/interface/GlobalPoint.h"
 #include <memory>
+#include <cstdint>
+
+#include "tbb/concurrent_unordered_map.h"
 
 
 // forwards
@@ -69,28 +72,46 @@ namespace L1TMuonEndCap {
     unsigned long long _magfield_cache_id;
     edm::ESHandle<MagneticField> _magfield;
 
+    // Global points already computed with the current geometry, keyed by
+    // (raw detId << 32 | position in the detector). The position is the
+    // halfstrip and wiregroup for CSC, the strip or pad cluster for RPC and
+    // GEM, and the theta BTI group for DT (only theta comes from geometry).
+    // ME0 uses continuous local coordinates and is not cached. The cache is
+    // cleared when the geometry changes, and filled concurrently by the
+    // sector processors.
+    typedef tbb::concurrent_unordered_map<uint64_t, GlobalPoint> point_cache_t;
+    mutable point_cache_t _point_cache;
+
+    template<typename F>
+    GlobalPoint getCachedPoint(uint64_t key, F compute) const;
+
     GlobalPoint getME0SpecificPoint(const TriggerPrimitive&) const;
     double calcME0SpecificEta(const TriggerPrimitive&) const;
     double calcME0SpecificPhi(const TriggerPrimitive&) const;
     double calcME0SpecificBend(const TriggerPrimitive&) const;
 
     GlobalPoint getGEMSpecificPoint(const TriggerPrimitive&) const;
+    GlobalPoint calcGEMSpecificPoint(const TriggerPrimitive&) const;
     double calcGEMSpecificEta(const TriggerPrimitive&) const;
     double calcGEMSpecificPhi(const TriggerPrimitive&) const;
     double calcGEMSpecificBend(const TriggerPrimitive&) const;
 
     GlobalPoint getRPCSpecificPoint(const TriggerPrimitive&) const;
+    GlobalPoint calcRPCSpecificPoint(const TriggerPrimitive&) const;
     double calcRPCSpecificEta(const TriggerPrimitive&) const;
     double calcRPCSpecificPhi(const TriggerPrimitive&) const;
     double calcRPCSpecificBend(const TriggerPrimitive&) const;
 
     GlobalPoint getCSCSpecificPoint(const TriggerPrimitive&) const;
+    GlobalPoint calcCSCSpecificPoint(const TriggerPrimitive&, unsigned halfstrip_offs) const;
+    unsigned getCSCHalfStripOffset(const TriggerPrimitive&) const;
     double calcCSCSpecificEta(const TriggerPrimitive&) const;
     double calcCSCSpecificPhi(const TriggerPrimitive&) const;
     double calcCSCSpecificBend(const TriggerPrimitive&) const;
     bool isCSCCounterClockwise(const std::unique_ptr<const CSCLayer>&) const;
 
     GlobalPoint calcDTSpecificPoint(const TriggerPrimitive&) const;
+    GlobalPoint calcDTSpecificThetaPoint(const TriggerPrimitive&) const;
     double calcDTSpecificEta(const TriggerPrimitive&) const;
     double calcDTSpecificPhi(const TriggerPrimitive&) const;
     double calcDTSpecificBend(const TriggerPrimitive&) const;
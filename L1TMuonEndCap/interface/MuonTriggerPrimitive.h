@@ -11,6 +11,10 @@
 // Note: Not all input data types are persistable, so we make local
 //       copies of all data from various digi types.
 //
+//       Only the data of the subsystem the TP belongs to is stored; the
+//       subsystem structs share the same storage. Use the get/access
+//       functions matching subsystem() only.
+//
 //       At the end of the day this should represent the output of some
 //       common sector receiver module.
 //
@@ -157,7 +161,7 @@ namespace L1TMuonEndCap {
     };
 
     //Persistency
-    TriggerPrimitive(): _subsystem(kNSubsystems) {}
+    TriggerPrimitive(): _dt(), _subsystem(kNSubsystems) {}
 
     //DT
     TriggerPrimitive(const DTChamberId&,
@@ -191,9 +195,9 @@ namespace L1TMuonEndCap {
                      const ME0Geometry& geom);
 
     //copy
-    TriggerPrimitive(const TriggerPrimitive&);
+    TriggerPrimitive(const TriggerPrimitive&) = default;
 
-    TriggerPrimitive& operator=(const TriggerPrimitive& tp);
+    TriggerPrimitive& operator=(const TriggerPrimitive& tp) = default;
     bool operator==(const TriggerPrimitive& tp) const;
 
     // return the subsystem we belong to
@@ -226,11 +230,11 @@ namespace L1TMuonEndCap {
     void setGEMData(const GEMData& gem) { _gem = gem; }
     void setME0Data(const ME0Data& me0) { _me0 = me0; }
 
-    const DTData  getDTData()  const { return _dt;  }
-    const CSCData getCSCData() const { return _csc; }
-    const RPCData getRPCData() const { return _rpc; }
-    const GEMData getGEMData() const { return _gem; }
-    const ME0Data getME0Data() const { return _me0; }
+    const DTData&  getDTData()  const { return _dt;  }
+    const CSCData& getCSCData() const { return _csc; }
+    const RPCData& getRPCData() const { return _rpc; }
+    const GEMData& getGEMData() const { return _gem; }
+    const ME0Data& getME0Data() const { return _me0; }
 
     DTData&  accessDTData()  { return _dt; }
     CSCData& accessCSCData() { return _csc; }
@@ -262,11 +266,14 @@ namespace L1TMuonEndCap {
         subsector = 0;
       }
 
-    DTData  _dt;
-    CSCData _csc;
-    RPCData _rpc;
-    GEMData _gem;
-    ME0Data _me0;
+    // only the member matching _subsystem is active
+    union {
+      DTData  _dt;
+      CSCData _csc;
+      RPCData _rpc;
+      GEMData _gem;
+      ME0Data _me0;
+    };
 
     DetId _id;
 
@@ -274,8 +281,8 @@ namespace L1TMuonEndCap {
 
     unsigned _globalsector; // [1,6] in 60 degree sectors
     unsigned _subsector; // [1,2] in 30 degree partitions of a sector
-    double _eta,_phi,_rho; // global pseudorapidity, phi, rho
-    double _theta; // bend angle with respect to ray from (0,0,0)
+    float _eta,_phi,_rho; // global pseudorapidity, phi, rho
+    float _theta; // bend angle with respect to ray from (0,0,0)
   };
 
 }
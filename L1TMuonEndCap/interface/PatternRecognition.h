@@ -2,16 +2,73 @@
 #define L1TMuonEndCap_PatternRecognition_h
 
 #include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+#include "L1Trigger/L1TMuonEndCap/interface/BXWindow.h"
+#include "L1Trigger/L1TMuonEndCap/interface/ConvHitStore.h"
 #include "L1Trigger/L1TMuonEndCap/interface/PhiMemoryImage.h"
 
 
+// Class declaration
+// - Lifetime state of every pattern detector [zone, keystrip, pattern] of one
+//   sector processor, tracked across BXs. The state is a BX counter, or a BX
+//   shifter if useSecondEarliest is set; 0 means the pattern has no hit.
+// - The keystrips with at least one live pattern are also flagged per zone,
+//   so that empty zones and keystrips can be skipped without a scan.
+class PatternLifetime {
+public:
+  typedef uint8_t value_t;
+  typedef std::array<uint64_t, 3> zone_mask_t;  // one bit per keystrip
+
+  static constexpr int MAX_PATTERNS = 16;
+
+  PatternLifetime() { clear(); }
+
+  void clear() {
+    values_.fill(0);
+    for (auto& mask : alive_)
+      mask.fill(0);
+  }
+
+  // izone is 0-based
+  value_t& at(int izone, int izhit, int ipatt) {
+    return values_[(izone * emtf::NUM_ZONE_HITS + izhit) * MAX_PATTERNS + ipatt];
+  }
+
+  const zone_mask_t& alive(int izone) const { return alive_[izone]; }
+
+  void set_alive(int izone, int izhit, bool alive) {
+    const uint64_t bit = uint64_t(1) << (izhit % 64);
+    if (alive)
+      alive_[izone][izhit / 64] |= bit;
+    else
+      alive_[izone][izhit / 64] &= ~bit;
+  }
+
+  bool is_zone_empty(int izone) const {
+    return (alive_[izone][0] | alive_[izone][1] | alive_[izone][2]) == 0;
+  }
+
+  bool empty() const {
+    for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
+      if (!is_zone_empty(izone))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  std::array<value_t, emtf::NUM_ZONES * emtf::NUM_ZONE_HITS * MAX_PATTERNS> values_;
+
+  emtf::zone_array<zone_mask_t> alive_;
+};
+
+
 class PatternRecognition {
 public:
   // Pattern detector ID: [zone, keystrip, pattern]
   typedef std::array<int, 3>  pattern_ref_t;
 
   void configure(
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       int bxWindow,
       const std::vector<std::string>& pattDefinitions, const std::vector<std::string>& symPattDefinitions, bool useSymPatterns,
       int maxRoadsPerZone, bool useSecondEarliest
@@ -20,27 +77,29 @@ public:
   void configure_details();
 
   void process(
-      const std::deque<EMTFHitCollection>& extended_conv_hits,
-      std::map<pattern_ref_t, int>& patt_lifetime_map,
+      int bx,
+      const BXWindow<EMTFHitCollection>& extended_conv_hits,
+      const ConvHitStore& conv_hit_store,
+      PatternLifetime& patt_lifetime,
       emtf::zone_array<EMTFRoadCollection>& zone_roads
   ) const;
 
   bool is_zone_empty(
       int zone,
-      const std::deque<EMTFHitCollection>& extended_conv_hits,
-      const std::map<pattern_ref_t, int>& patt_lifetime_map
+      const ConvHitStore& conv_hit_store,
+      const PatternLifetime& patt_lifetime
   ) const;
 
   void make_zone_image(
       int zone,
-      const std::deque<EMTFHitCollection>& extended_conv_hits,
+      const ConvHitStore& conv_hit_store,
       PhiMemoryImage& image
   ) const;
 
   void process_single_zone(
-      int zone,
-      PhiMemoryImage cloned_image,
-      std::map<pattern_ref_t, int>& patt_lifetime_map,
+      int zone, int bx,
+      const PhiMemoryImage& image,
+      PatternLifetime& patt_lifetime,
       EMTFRoadCollection& roads
   ) const;
 
@@ -48,7 +107,7 @@ public:
 
 
 private:
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
 
   int bxWindow_;
   std::vector<std::string> pattDefinitions_, symPattDefinitions_;
@@ -57,6 +116,17 @@ private:
   bool useSecondEarliest_;
 
   std::vector<PhiMemoryImage> patterns_;
+
+  // Each pattern as runs of consecutive bits per layer, for the bit-parallel
+  // matching in process_single_zone()
+  struct PatternWindow {
+    int layer;  // [0,1,2,3] --> [st1,st2,st3,st4]
+    int shift;  // position of the first bit w.r.t. the key zone hit
+    int width;  // number of bits
+    int level;  // floor(log2(width))
+  };
+  std::vector<std::vector<PatternWindow> > pattern_windows_;
+  int max_window_level_;
 };
 
 #endif
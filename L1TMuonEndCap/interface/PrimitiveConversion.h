@@ -2,6 +2,7 @@
 #define L1TMuonEndCap_PrimitiveConversion_h
 
 #include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+#include "L1Trigger/L1TMuonEndCap/interface/PrimitiveLinkTable.h"
 
 
 class SectorProcessorLUT;
@@ -11,18 +12,35 @@ public:
   void configure(
       const GeometryTranslator* tp_geom,
       const SectorProcessorLUT* lut,
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
       const std::vector<int>& zoneBoundaries, int zoneOverlap,
       bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges,
-      bool bugME11Dupes
+      bool bugME11Dupes, bool fillSimCoords
   );
 
   void process(
-      const std::map<int, TriggerPrimitiveCollection>& selected_prim_map,
+      const PrimitiveLinkTable& selected_prim_map,
       EMTFHitCollection& conv_hits
   ) const;
 
+  // Convert the inclusive (not truncated) primitives, and derive the hits of the
+  // truncated primitives from them. The truncated primitives must be a subset of
+  // the inclusive ones, in the same order within each link. A hit is only
+  // converted again if its position in the chamber (pc_segment) is different.
+  void process(
+      const PrimitiveLinkTable& inclusive_selected_prim_map,
+      const PrimitiveLinkTable& selected_prim_map,
+      EMTFHitCollection& inclusive_conv_hits,
+      EMTFHitCollection& conv_hits
+  ) const;
+
+  void convert_prim(
+      int selected, int pc_segment,
+      const TriggerPrimitive& muon_primitive,
+      EMTFHit& conv_hit
+  ) const;
+
   const SectorProcessorLUT& lut() const { return *lut_; }
 
   // CSC functions
@@ -43,6 +61,8 @@ public:
 
   void convert_rpc_details(EMTFHit& conv_hit, bool isCPPF) const;  // with specific firmware impl
 
+  bool use_cppf_lut(bool isCPPF) const;  // phi and theta from the CPPF LUTs
+
   // GEM functions
   void convert_gem(
       int pc_sector, int pc_station, int pc_chamber, int pc_segment,
@@ -88,7 +108,7 @@ private:
 
   const SectorProcessorLUT* lut_;
 
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
 
   int bxShiftCSC_, bxShiftRPC_, bxShiftGEM_;
 
@@ -96,6 +116,7 @@ private:
   int zoneOverlap_;
   bool duplicateTheta_, fixZonePhi_, useNewZones_, fixME11Edges_;
   bool bugME11Dupes_;
+  bool fillSimCoords_;
 };
 
 #endif
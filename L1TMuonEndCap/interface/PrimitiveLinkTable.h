@@ -0,0 +1,82 @@
+#ifndef L1TMuonEndCap_PrimitiveLinkTable_h
+#define L1TMuonEndCap_PrimitiveLinkTable_h
+
+#include <bitset>
+#include <cassert>
+
+#include "boost/container/small_vector.hpp"
+
+#include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+
+
+// Class declaration
+// - Trigger primitives selected by one sector processor in one BX, indexed
+//   by the "link" index returned by PrimitiveSelection::select_*().
+// - Each link keeps its primitives in a small inline vector sized to the
+//   firmware limit (2 LCTs per chamber, 4 after theta duplication). Only the
+//   transient pre-truncation lists and merge_no_truncate() can go beyond
+//   that, in which case the link spills to the heap.
+// - The links in use are tracked in a bitset. A link is in use as soon as it
+//   is accessed with operator[], even if it stays empty, like the keys of the
+//   std::map<int, TriggerPrimitiveCollection> this replaces. Iterating over
+//   the links in use goes in increasing link index, also like the map.
+class PrimitiveLinkTable {
+public:
+  typedef boost::container::small_vector<TriggerPrimitive, emtf::NUM_LINK_HITS> link_t;
+
+  // Access a link, marks it in use
+  link_t& operator[](int link) {
+    assert(0 <= link && link < emtf::NUM_LINKS);
+    used_.set(link);
+    return links_[link];
+  }
+
+  const link_t& at(int link) const {
+    assert(0 <= link && link < emtf::NUM_LINKS);
+    return links_[link];
+  }
+
+  // Same as map.find(link) != map.end()
+  bool has(int link) const { return used_.test(link); }
+
+  bool empty() const { return used_.none(); }
+
+  // Returns the first link in use at or after the given index, or NUM_LINKS
+  int next(int link) const {
+    while (link < emtf::NUM_LINKS && !used_.test(link))
+      ++link;
+    return link;
+  }
+
+  // Only the links in use are cleared
+  void clear() {
+    for (int link = next(0); link < emtf::NUM_LINKS; link = next(link+1))
+      links_[link].clear();
+    used_.reset();
+  }
+
+  // Append all the links in use of another table, like merge_map_into_map()
+  void merge(const PrimitiveLinkTable& other) {
+    for (int link = other.next(0); link < emtf::NUM_LINKS; link = other.next(link+1)) {
+      const link_t& src = other.links_[link];
+      link_t& dst = (*this)[link];
+      dst.insert(dst.end(), src.begin(), src.end());
+    }
+  }
+
+  // Move the content of another table into this one, leaves the other table empty.
+  // The links are swapped, so that both tables keep their capacity.
+  void take(PrimitiveLinkTable& other) {
+    clear();
+    for (int link = other.next(0); link < emtf::NUM_LINKS; link = other.next(link+1))
+      (*this)[link].swap(other.links_[link]);
+    other.clear();
+  }
+
+private:
+  std::array<link_t, emtf::NUM_LINKS> links_;
+
+  std::bitset<emtf::NUM_LINKS> used_;
+};
+
+#endif
@@ -2,21 +2,23 @@
 #define L1TMuonEndCap_PrimitiveMatching_h
 
 #include "L1Trigger/L1TMuonEndCap/interface/Common.h"
+#include "L1Trigger/L1TMuonEndCap/interface/ConvHitStore.h"
 
 
 class PrimitiveMatching {
 public:
-  typedef EMTFHitCollection::const_iterator hit_ptr_t;
+  typedef int hit_ptr_t;  // index in ConvHitStore::ZoneStationHits, -1 if none
   typedef std::pair<int, hit_ptr_t> hit_sort_pair_t;  // key=ph_diff, value=hit
 
   void configure(
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       bool fixZonePhi, bool useNewZones,
       bool bugSt2PhDiff, bool bugME11Dupes
   );
 
   void process(
-      const std::deque<EMTFHitCollection>& extended_conv_hits,
+      int bx,
+      const ConvHitStore& conv_hit_store,
       const emtf::zone_array<EMTFRoadCollection>& zone_roads,
       emtf::zone_array<EMTFTrackCollection>& zone_tracks
   ) const;
@@ -24,17 +26,17 @@ public:
   void process_single_zone_station(
       int zone, int station,
       const EMTFRoadCollection& roads,
-      const EMTFHitCollection& conv_hits,
+      const ConvHitStore::ZoneStationHits& conv_hits,
       std::vector<hit_sort_pair_t>& phi_differences
   ) const;
 
   void insert_hits(
-      hit_ptr_t conv_hit_ptr, const EMTFHitCollection& conv_hits,
+      hit_ptr_t conv_hit_ptr, const ConvHitStore::ZoneStationHits& conv_hits,
       EMTFTrack& track
   ) const;
 
 private:
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
 
   bool fixZonePhi_, useNewZones_;
   bool bugSt2PhDiff_, bugME11Dupes_;
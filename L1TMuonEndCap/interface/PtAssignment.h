@@ -11,22 +11,20 @@ class PtAssignment {
 public:
   void configure(
       PtAssignmentEngine* pt_assign_engine,
-      int verbose, int endcap, int sector, int bx,
-      bool readPtLUTFile, bool fixMode15HighPt,
-      bool bug9BitDPhi, bool bugMode7CLCT, bool bugNegPt,
+      int verbose, int endcap, int sector,
       bool bugGMTPhi, bool promoteMode7, int modeQualVer
   );
 
   void process(
       EMTFTrackCollection& best_tracks
-  );
+  ) const;
 
   const PtAssignmentEngineAux& aux() const;
 
 private:
   PtAssignmentEngine* pt_assign_engine_;
 
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
 
   bool bugGMTPhi_, promoteMode7_;
   int modeQualVer_;
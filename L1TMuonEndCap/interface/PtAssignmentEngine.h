@@ -12,6 +12,7 @@
 #include "L1Trigger/L1TMuonEndCap/interface/PtAssignmentEngineAux.h"
 #include "L1Trigger/L1TMuonEndCap/interface/PtLUTReader.h"
 #include "L1Trigger/L1TMuonEndCap/interface/bdt/Forest.h"
+#include "L1Trigger/L1TMuonEndCap/interface/bdt/FlatForest.h"
 
 
 class PtAssignmentEngine {
@@ -24,6 +25,7 @@ public:
   void read(int pt_lut_version, const std::string& xml_dir);
   void load(int pt_lut_version, const L1TMuonEndCapForest *payload);
   const std::array<emtf::Forest, 16>& getForests(void) const { return forests_; }
+  const std::array<emtf::FlatForest, 16>& getFlatForests(void) const { return flat_forests_; }
   const std::vector<int>& getAllowedModes(void) const { return allowedModes_; }
 
   int get_pt_lut_version() const { return ptLUTVersion_; }
@@ -36,23 +38,30 @@ public:
 
   void configure_details();
 
+  void configure_ptlut_reader(bool mmapPtLUTFile, bool populatePtLUTFile);
+
   const PtAssignmentEngineAux& aux() const;
 
   virtual float scale_pt  (const float pt, const int mode = 15) const = 0;
   virtual float unscale_pt(const float pt, const int mode = 15) const = 0;
 
   virtual address_t calculate_address(const EMTFTrack& track) const { return 0; }
+  virtual address_t canonical_address(const address_t& address) const { return address; }
 
   virtual float calculate_pt(const address_t& address) const;
   virtual float calculate_pt(const EMTFTrack& track) const;
+  virtual void calculate_pt_batch(const address_t* addresses, unsigned int n, float* pts) const;
 
   virtual float calculate_pt_lut(const address_t& address) const;
   virtual float calculate_pt_xml(const address_t& address) const { return 0.; }
   virtual float calculate_pt_xml(const EMTFTrack& track) const { return 0.; }
+  virtual void calculate_pt_xml_batch(const address_t* addresses, unsigned int n, float* pts) const;
 
 protected:
   std::vector<int> allowedModes_;
   std::array<emtf::Forest, 16> forests_;
+  std::array<emtf::FlatForest, 16> flat_forests_;  // compiled copy of forests_ used for inference
+  static constexpr unsigned flat_forest_ntrees_ = 400;  // number of trees evaluated, as Forest::predictEvent(e, 400)
   PtLUTReader ptlut_reader_;
 
   int verbose_;
@@ -14,8 +14,16 @@ public:
   float scale_pt  (const float pt, const int mode = 15) const override;
   float unscale_pt(const float pt, const int mode = 15) const override;
   address_t calculate_address(const EMTFTrack& track) const override;
+  address_t canonical_address(const address_t& address) const override;
   float calculate_pt_xml(const address_t& address) const override;
   float calculate_pt_xml(const EMTFTrack& track) const override;
+  void calculate_pt_xml_batch(const address_t* addresses, unsigned int n, float* pts) const override;
+
+  // Up to 20 BDT input variables (mode 15), unused entries are zero
+  typedef std::array<int, 20> predictors_t;
+
+  int calculate_predictors(const address_t& address, predictors_t& predictors) const;
+  float predict_xml(int mode, const predictors_t& predictors) const;
 
 private:
 };
@@ -11,10 +11,18 @@ public:
   explicit PtLUTReader();
   ~PtLUTReader();
 
+  // Non-copyable, as the destructor unmaps the file
+  PtLUTReader(const PtLUTReader&) = delete;
+  PtLUTReader& operator=(const PtLUTReader&) = delete;
+
   typedef uint16_t               content_t;
   typedef uint64_t               address_t;
   typedef std::vector<content_t> table_t;
 
+  // If useMmap, the file is mapped read-only and shared instead of being unpacked into memory.
+  // If populate, the mapping is pre-faulted (MAP_POPULATE) and huge pages are requested.
+  void configure(bool useMmap, bool populate);
+
   void read(const std::string& lut_full_path);
 
   content_t lookup(const address_t& address) const;
@@ -22,9 +30,15 @@ public:
   content_t get_version() const { return version_; }
 
 private:
+  void read_mmap(const std::string& lut_full_path);
+
   mutable table_t ptlut_;
   content_t version_;
   bool ok_;
+
+  bool use_mmap_, populate_;
+  const uint64_t* mapped_;  // 4 packed 9-bit words per uint64_t, as written by PtLUTWriter
+  size_t mapped_size_;
 };
 
 #endif
@@ -19,6 +19,13 @@ public:
 
   void push_back(const content_t& pt);
 
+  // Pre-size the table to n entries, which can then be filled in any order (e.g. by several threads)
+  void resize(const address_t& n);
+
+  void set(const address_t& index, const content_t& pt) { ptlut_[index] = pt; }
+
+  content_t get(const address_t& index) const { return ptlut_[index]; }
+
   void set_version(content_t ver) { version_ = ver; }
 
   content_t get_version() const { return version_; }
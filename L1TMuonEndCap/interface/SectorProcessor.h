@@ -1,7 +1,6 @@
 #ifndef L1TMuonEndCap_SectorProcessor_h
 #define L1TMuonEndCap_SectorProcessor_h
 
-#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -41,7 +40,7 @@ public:
       int minBX, int maxBX, int bxWindow, int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
       std::string era,
       const std::vector<int>& zoneBoundaries, int zoneOverlap,
-      bool includeNeighbor, bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges,
+      bool includeNeighbor, bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges, bool fillSimCoords,
       const std::vector<std::string>& pattDefinitions, const std::vector<std::string>& symPattDefinitions, bool useSymPatterns,
       int thetaWindow, int thetaWindowZone0, bool useRPC, bool useSingleHits, bool bugSt2PhDiff, bool bugME11Dupes, bool bugAmbigThetaWin, bool twoStationSameBX,
       int maxRoadsPerZone, int maxTracks, bool useSecondEarliest, bool bugSameSectorPt0,
@@ -50,10 +49,26 @@ public:
 
   void configure_by_fw_version(unsigned fw_version);
 
+  void configure_params_by_fw_version(unsigned fw_version);
+
+  // Configure the pipeline stages. They are reused for every BX of every event.
+  void configure_stages();
+
+  // Configure the pT assignment engine, which is shared by all the sector
+  // processors, with the settings of this sector processor. It must be called
+  // by the TrackFinder outside of the sector loop, which can run in parallel.
+  void configure_pt_assign_engine() const;
+
+  // Range of the BXs of the primitives used by this sector processor, which
+  // can be changed by the configuration by firmware version
+  int get_min_prim_bx() const { return minBX_; }
+  int get_max_prim_bx() const { return maxBX_ + bxWindow_ - 1; }
+
   void process(
       // Input
       EventNumber_t ievent,
       const TriggerPrimitiveCollection& muon_primitives,
+      const EMTFPrimitiveIndex& prim_index,
       // Output
       EMTFHitCollection& out_hits,
       EMTFTrackCollection& out_tracks
@@ -63,13 +78,15 @@ public:
       // Input
       int bx,
       const TriggerPrimitiveCollection& muon_primitives,
+      const EMTFPrimitiveIndex& prim_index,
       // Output
       EMTFHitCollection& out_hits,
       EMTFTrackCollection& out_tracks,
       // Intermediate objects
-      std::deque<EMTFHitCollection>& extended_conv_hits,
-      std::deque<EMTFTrackCollection>& extended_best_track_cands,
-      std::map<pattern_ref_t, int>& patt_lifetime_map
+      BXWindow<EMTFHitCollection>& extended_conv_hits,
+      BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands,
+      PatternLifetime& patt_lifetime,
+      ConvHitStore& conv_hit_store
   ) const;
 
 private:
@@ -91,6 +108,7 @@ private:
   std::vector<int> zoneBoundaries_;
   int zoneOverlap_;
   bool includeNeighbor_, duplicateTheta_, fixZonePhi_, useNewZones_, fixME11Edges_;
+  bool fillSimCoords_;
 
   // For pattern recognition
   std::vector<std::string> pattDefinitions_, symPattDefinitions_;
@@ -110,6 +128,38 @@ private:
   bool readPtLUTFile_, fixMode15HighPt_;
   bool bug9BitDPhi_, bugMode7CLCT_, bugNegPt_, bugGMTPhi_, promoteMode7_;
   int modeQualVer_;
+
+  // Firmware version used by configure_by_fw_version
+  unsigned fw_version_;
+
+  // Pipeline stages
+  PrimitiveSelection prim_sel_;
+  PrimitiveConversion prim_conv_;
+  PatternRecognition patt_recog_;
+  PrimitiveMatching prim_match_;
+  AngleCalculation angle_calc_;
+  BestTrackSelection btrack_sel_;
+  SingleHitTrack single_hit_;
+  PtAssignment pt_assign_;
+
+  // Converted hits and best track candidates of the last bxWindow BXs.
+  // Only used inside process(), kept here so that their memory is reused
+  // by the next events. Each sector has its own SectorProcessor, so this
+  // is safe when the sectors run in parallel.
+  mutable BXWindow<EMTFHitCollection> extended_conv_hits_;
+  mutable BXWindow<emtf::zone_array<EMTFTrackCollection> > extended_best_track_cands_;
+
+  // Compact copy of the converted hits in the BX window, rebuilt every BX
+  mutable ConvHitStore conv_hit_store_;
+
+  // Intermediate objects of process_single_bx(), cleared every BX. They are
+  // kept here for the same reason as above, so that the BX loop does not
+  // allocate once their capacity has grown to fit the busiest BX.
+  mutable PrimitiveLinkTable selected_dt_map_, selected_csc_map_, selected_rpc_map_, selected_gem_map_, selected_me0_map_;
+  mutable PrimitiveLinkTable selected_prim_map_, inclusive_selected_prim_map_;
+  mutable EMTFHitCollection inclusive_conv_hits_;
+  mutable emtf::zone_array<EMTFRoadCollection> zone_roads_;
+  mutable EMTFTrackCollection best_tracks_;
 };
 
 #endif
@@ -7,19 +7,20 @@
 class SingleHitTrack {
 public:
   void configure(
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       int maxTracks,
       bool useSingleHits
   );
 
   void process(
+      int bx,
       const EMTFHitCollection& conv_hits,
       EMTFTrackCollection& best_tracks
   ) const;
 
 
 private:
-  int verbose_, endcap_, sector_, bx_;
+  int verbose_, endcap_, sector_;
   int maxTracks_;
   bool useSingleHits_;
 };
@@ -11,7 +11,9 @@
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "L1Trigger/L1TMuonEndCap/interface/EMTFPrimitiveIndex.h"
 #include "L1Trigger/L1TMuonEndCap/interface/SectorProcessor.h"
+#include "L1Trigger/L1TMuonEndCap/interface/experimental/Phase2SectorProcessor.h"
 
 
 class TrackFinder {
@@ -36,8 +38,14 @@ private:
 
   std::unique_ptr<PtAssignmentEngine> pt_assign_engine_;
 
+  EMTFPrimitiveIndex prim_index_;
+
   emtf::sector_array<SectorProcessor> sector_processors_;
 
+  emtf::sector_array<experimental::Phase2SectorProcessor> expt_sector_processors_;
+
+  experimental::Phase2Context expt_context_;
+
   const edm::ParameterSet config_;
 
   const edm::EDGetToken tokenDTPhi_, tokenDTTheta_, tokenCSC_, tokenCSCComparator_, tokenRPC_, tokenRPCRecHit_, tokenCPPF_, tokenGEM_, tokenME0_;
@@ -46,6 +54,10 @@ private:
 
   bool fwConfig_, useDT_, useCSC_, useRPC_, useCPPF_, useGEM_, useIRPC_, useME0_;
 
+  bool parallelSectors_;
+
+  bool phase2NativeNN_;
+
   std::string era_;
 };
 
@@ -0,0 +1,61 @@
+// FlatForest.h
+
+#ifndef L1Trigger_L1TMuonEndCap_emtf_FlatForest
+#define L1Trigger_L1TMuonEndCap_emtf_FlatForest
+
+#include <vector>
+#include "Forest.h"
+
+namespace emtf {
+
+// Read-only, inference-only copy of a Forest. All nodes of all trees are
+// stored contiguously in pre-order, so the left daughter of node i is node
+// i+1 and only the right daughter index needs to be kept. Evaluation needs
+// no Event and does no allocation, and is safe to call concurrently.
+class FlatForest
+{
+    public:
+
+        struct FlatNode
+        {
+            int splitVariable;   // -1 for a terminal node
+            int splitValue;      // go left if feature < splitValue
+            unsigned int next;   // right daughter, or index into leafValues for a terminal node
+        };
+
+        FlatForest();
+        ~FlatForest();
+
+        // Build from the first numtrees trees of the forest, same as Forest::predictEvent.
+        void compile(Forest& forest, unsigned int numtrees);
+        void clear();
+
+        bool empty() const { return roots.empty(); }
+
+        // Returns the number of trees in the forest.
+        unsigned int size() const { return roots.size(); }
+
+        // Identical to Forest::predictEvent(e, numtrees) with e->data = features.
+        double predict(const int* features) const;
+
+        // Same as predict() for n feature rows spaced by stride ints, e.g. one
+        // mode's worth of tracks or LUT addresses. Each tree is applied to the
+        // whole batch before moving on, 8 rows at a time with AVX2 if available.
+        void predictBatch(const int* features, unsigned int stride, unsigned int n, double* predictedValues) const;
+
+    private:
+
+        unsigned int compileRecursive(Node* node);
+
+        void predictBlock(const int* features, unsigned int stride, unsigned int n, double* predictedValues) const;
+        void predictBlock8(const int* features, unsigned int stride, double* predictedValues) const;
+
+        std::vector<FlatNode> nodes;
+        std::vector<double> leafValues;
+        std::vector<unsigned int> roots;
+        double boostWeight;
+};
+
+} // end of emtf namespace
+
+#endif
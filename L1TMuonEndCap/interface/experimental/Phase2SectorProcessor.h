@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <array>
 #include <deque>
+#include <fstream>
 #include <functional>
 #include <map>
 #include <memory>
@@ -44,33 +45,98 @@ class Hit;   // internal class
 class Road;  // internal class
 class Track; // internal class
 
+// Per-stream state of the Phase 2 sector processors. It is owned by the
+// TrackFinder (one per stream) and shared by its 12 sector processors, so the
+// sector processors themselves hold no global or static mutable state.
+class Phase2Context {
+public:
+  explicit Phase2Context();
+  ~Phase2Context();
+
+  // Stacked NN inputs and outputs of all the sector processors, reused in
+  // every BX to keep the allocated capacity
+  std::vector<float> features, predictions;
+
+  // Tracks of all the sector processors, for the ghost busting
+  std::vector<Track> tracks;
+
+  // Debug output of the pattern recognition, only written if PR_IO_FILE is
+  // defined in src/experimental/Phase2SectorProcessor.cc
+  std::ofstream pattrec_file;
+};
+
+// Scratch buffers of the pattern recognition, reused in every BX to keep the
+// allocated capacity. Each sector processor has its own, as the sector
+// processors can run in parallel. See PatternRecognition::apply_patterns() in
+// src/experimental/Phase2SectorProcessor.cc
+class Phase2PatternBuffers {
+public:
+  std::vector<int32_t> cell_counts;      // per cell: number of hits, zero between calls
+  std::vector<uint32_t> cell_layers;     // per cell: bitmask of the hit layers, zero between calls
+  std::vector<int32_t> touched_cells;    // cells with at least one hit
+  std::vector<int32_t> touched_offsets;  // start of the hit indices of each touched cell
+  std::vector<int32_t> cell_hits;        // hit indices of all the touched cells
+};
+
 class Phase2SectorProcessor {
 public:
+  explicit Phase2SectorProcessor();
+  ~Phase2SectorProcessor();
+
   void configure(
       // Object pointers
       const GeometryTranslator* geom,
       const ConditionHelper* cond,
       const SectorProcessorLUT* lut,
       PtAssignmentEngine* pt_assign_engine,
+      Phase2Context* context,
       // Sector processor config
       int verbose, int endcap, int sector, int bx,
       int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
       std::string era
   );
 
-  void process(
+  // The processing is split in steps, so that the NN is evaluated once for the
+  // roads of all the sector processors, and the ghost busting is done across
+  // the tracks of all the sector processors.
+  // Step 1: build the roads and the NN inputs
+  void process_roads(
       // Input
       const edm::Event& iEvent, const edm::EventSetup& iSetup,
       const TriggerPrimitiveCollection& muon_primitives,
+      const EMTFPrimitiveIndex& prim_index
+  );
+
+  // Step 2: build the tracks from the NN outputs
+  void process_tracks();
+
+  // Step 3: output the hits and the tracks that are not ghosts
+  void process_output(
       // Output
       EMTFHitCollection& out_hits,
       EMTFTrackCollection& out_tracks
-  ) const;
+  );
+
+  // Evaluate the NN in a single call for the roads of all the sector processors,
+  // between step 1 and step 2. If use_native_nn is true, the NN is evaluated
+  // natively instead of with Tensorflow.
+  // With Tensorflow, the outputs of a road are not guaranteed to be bitwise
+  // identical to those of the road evaluated alone, since the kernels depend
+  // on the batch size. They agree within a relative 1e-5 (see test_batch in
+  // test/unittests/TestTensorFlow.cpp). The native NN gives identical results.
+  static void assign_pt(emtf::sector_array<Phase2SectorProcessor>& sector_processors, Phase2Context& context, bool use_native_nn);
+
+  // Remove the ghosts among the tracks of all the sector processors (like the
+  // uGMT), between step 2 and step 3
+  static void remove_ghosts(emtf::sector_array<Phase2SectorProcessor>& sector_processors, Phase2Context& context);
 
 private:
-  void build_tracks(
+  void build_roads(
       // Input
-      const EMTFHitCollection& conv_hits,
+      const EMTFHitCollection& conv_hits
+  );
+
+  void build_tracks(
       // Output
       std::vector<Track>& best_tracks
   ) const;
@@ -100,10 +166,34 @@ private:
 
   PtAssignmentEngine* pt_assign_engine_;
 
+  Phase2Context* context_;
+
   int verbose_, endcap_, sector_, bx_,
       bxShiftCSC_, bxShiftRPC_, bxShiftGEM_;
 
   std::string era_;
+
+  // Primitive selection & primitive conversion, configured in configure()
+  PrimitiveSelection prim_sel_;
+  PrimitiveConversion prim_conv_;
+
+  // Intermediate objects of process_roads(), cleared every call. They are
+  // kept here so that their memory is reused by the next events.
+  PrimitiveLinkTable selected_dt_map_, selected_csc_map_, selected_rpc_map_, selected_gem_map_, selected_me0_map_;
+  PrimitiveLinkTable selected_prim_map_;
+
+  // Objects kept from step 1 to step 2
+  EMTFHitCollection conv_hits_;
+  std::vector<Hit> hits_;
+  std::vector<Road> roads_, clean_roads_, slim_roads_;
+  std::vector<float> features_;     // NN inputs, one row per slim road
+  std::vector<float> predictions_;  // NN outputs, one row per slim road
+
+  // Scratch buffers of the pattern recognition
+  Phase2PatternBuffers pattern_buffers_;
+
+  // Objects kept from step 2 to step 3
+  std::vector<Track> best_tracks_;  // 'Track' is an internal class
 };
 
 }  // namesapce experimental
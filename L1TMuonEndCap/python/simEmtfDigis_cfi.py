@@ -40,6 +40,17 @@ simEmtfDigisMC = cms.EDProducer("L1TMuonEndCapTrackProducer",
     IRPCEnable = cms.bool(False),
     ME0Enable = cms.bool(False),
 
+    # Run the 12 sector processors concurrently on the TBB task pool (output is identical to the serial loop)
+    ParallelSectors = cms.bool(False),
+
+    # Fill the full-simulation coordinates (phi_sim, theta_sim, eta_sim, rho_sim, z_sim) of the output hits.
+    # They are not used in track-building; hits whose coordinates come from full simulation (GEM, ME0, DT, iRPC) always have them
+    FillSimCoordinates = cms.bool(True),
+
+    # Evaluate the Phase 2 pT NN natively (weights in src/experimental/ptnnweights.icc) instead of with Tensorflow.
+    # Only used with Era 'Phase2_timing'
+    Phase2NativeNN = cms.bool(False),
+
     # Era (options: 'Run2_2016', 'Run2_2017', 'Run2_2018')
     Era = cms.string('Run2_2018'),
 
@@ -115,6 +126,8 @@ simEmtfDigisMC = cms.EDProducer("L1TMuonEndCapTrackProducer",
     # Sector processor pt-assignment parameters
     spPAParams16 = cms.PSet(
         ReadPtLUTFile   = cms.bool(False),
+        MmapPtLUTFile   = cms.bool(False), # Map the LUT file read-only and shared instead of loading it (with ReadPtLUTFile)
+        PopulatePtLUTFile = cms.bool(False), # Pre-fault the mapped LUT and ask for huge pages (with MmapPtLUTFile)
         FixMode15HighPt = cms.bool(True),  # High-pT fix puts outlier LCTs in mode 15 tracks back in a straight line
         Bug9BitDPhi     = cms.bool(False), # dPhi wrap-around in modes 3, 5, 6, 9, 10, 12
         BugMode7CLCT    = cms.bool(False), # pT LUT written with incorrect values for mode 7 CLCT, mode 10 random offset
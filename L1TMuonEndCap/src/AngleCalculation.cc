@@ -12,7 +12,7 @@ namespace {
 
 
 void AngleCalculation::configure(
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     int bxWindow,
     int thetaWindow, int thetaWindowZone0,
     bool bugME11Dupes, bool bugAmbigThetaWin, bool twoStationSameBX
@@ -20,7 +20,6 @@ void AngleCalculation::configure(
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   bxWindow_         = bxWindow;
   thetaWindow_      = thetaWindow;
@@ -31,6 +30,7 @@ void AngleCalculation::configure(
 }
 
 void AngleCalculation::process(
+    int bx,
     emtf::zone_array<EMTFTrackCollection>& zone_tracks
 ) const {
 
@@ -56,7 +56,7 @@ void AngleCalculation::process(
     // Calculate bx
     // (in the firmware, this happens during best track selection.)
     for (; tracks_it != tracks_end; ++tracks_it) {
-      calculate_bx(*tracks_it);
+      calculate_bx(*tracks_it, bx);
     }
   }  // end loop over zones
 
@@ -476,23 +476,23 @@ void AngleCalculation::calculate_angles(EMTFTrack& track, const int izone) const
 
 }
 
-void AngleCalculation::calculate_bx(EMTFTrack& track) const {
+void AngleCalculation::calculate_bx(EMTFTrack& track, int bx) const {
   const int delayBX = bxWindow_ - 1;
   assert(delayBX >= 0);
   std::vector<int> counter(delayBX+1, 0);
 
   for (const auto& conv_hit : track.Hits()) {
     for (int i = delayBX; i >= 0; i--) {
-      if (conv_hit.BX() <= bx_ - i)
+      if (conv_hit.BX() <= bx - i)
         counter.at(i) += 1;  // Count stubs delayed by i BX or more
     }
   }
 
-  int first_bx = bx_ - delayBX;
+  int first_bx = bx - delayBX;
   int second_bx = 99;
   for (int i = delayBX; i >= 0; i--) {
     if (counter.at(i) >= 2) { // If 2 or more stubs are delayed by i BX or more
-      second_bx = bx_ - i; // if i == delayBX, analyze immediately
+      second_bx = bx - i; // if i == delayBX, analyze immediately
       break;
     }
   }
@@ -4,7 +4,7 @@
 
 
 void BestTrackSelection::configure(
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     int bxWindow,
     int maxRoadsPerZone, int maxTracks, bool useSecondEarliest,
     bool bugSameSectorPt0
@@ -12,7 +12,6 @@ void BestTrackSelection::configure(
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   bxWindow_           = bxWindow;
   maxRoadsPerZone_    = maxRoadsPerZone;
@@ -22,14 +21,17 @@ void BestTrackSelection::configure(
 }
 
 void BestTrackSelection::process(
-    const std::deque<EMTFTrackCollection>& extended_best_track_cands,
+    int bx,
+    const BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands,
     EMTFTrackCollection& best_tracks
 ) const {
   int num_cands = 0;
-  for (const auto& cands : extended_best_track_cands) {
-    for (const auto& cand : cands) {
-      if (cand.Rank() > 0) {
-        num_cands += 1;
+  for (const auto& zone_cands : extended_best_track_cands) {
+    for (const auto& cands : zone_cands) {
+      for (const auto& cand : cands) {
+        if (cand.Rank() > 0) {
+          num_cands += 1;
+        }
       }
     }
   }
@@ -42,7 +44,7 @@ void BestTrackSelection::process(
   if (!useSecondEarliest_) {
     cancel_one_bx(extended_best_track_cands, best_tracks);
   } else {
-    cancel_multi_bx(extended_best_track_cands, best_tracks);
+    cancel_multi_bx(bx, extended_best_track_cands, best_tracks);
   }
 
   if (verbose_ > 0) {  // debug
@@ -69,7 +71,7 @@ void BestTrackSelection::process(
 }
 
 void BestTrackSelection::cancel_one_bx(
-    const std::deque<EMTFTrackCollection>& extended_best_track_cands,
+    const BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands,
     EMTFTrackCollection& best_tracks
 ) const {
   const int max_z = emtf::NUM_ZONES;  // = 4 zones
@@ -91,7 +93,7 @@ void BestTrackSelection::cancel_one_bx(
 
   // Initialize arrays: rank, segments
   for (int z = 0; z < max_z; ++z) {
-    const EMTFTrackCollection& tracks = extended_best_track_cands.at(z);
+    const EMTFTrackCollection& tracks = extended_best_track_cands.latest(0).at(z);
     const int ntracks = tracks.size();
     assert(ntracks <= max_n);
 
@@ -238,7 +240,7 @@ void BestTrackSelection::cancel_one_bx(
         n = i / max_z;
         z = i % max_z;
 
-        const EMTFTrackCollection& tracks = extended_best_track_cands.at(z);
+        const EMTFTrackCollection& tracks = extended_best_track_cands.latest(0).at(z);
         const EMTFTrack& track = tracks.at(n);
         best_tracks.push_back(track);
 
@@ -252,7 +254,8 @@ void BestTrackSelection::cancel_one_bx(
 }
 
 void BestTrackSelection::cancel_multi_bx(
-    const std::deque<EMTFTrackCollection>& extended_best_track_cands,
+    int bx,
+    const BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands,
     EMTFTrackCollection& best_tracks
 ) const {
   const int max_h = bxWindow_;        // = 3 bx history
@@ -263,7 +266,7 @@ void BestTrackSelection::cancel_multi_bx(
   assert(maxTracks_ <= max_hzn);
 
   const int delayBX = bxWindow_ - 1;
-  const int num_h = extended_best_track_cands.size() / max_z;  // num of bx history so far
+  const int num_h = extended_best_track_cands.size();  // num of bx history so far
 
   // Emulate the arrays used in firmware
   typedef std::array<int, 3> segment_ref_t;
@@ -279,12 +282,12 @@ void BestTrackSelection::cancel_multi_bx(
 
   // Initialize arrays: rank, good_bx, segments
   for (int h = 0; h < num_h; ++h) {
-    // extended_best_track_cands[0..3] has 4 zones for road/pattern BX-0 (i.e. current) with possible tracks from [BX-2, BX-1, BX-0]
-    // extended_best_track_cands[4..7] has 4 zones for road/pattern BX-1 with possible tracks from [BX-3, BX-2, BX-1]
-    // extended_best_track_cands[8..11] has 4 zones for road/pattern BX-2 with possible tracks from [BX-4, BX-3, BX-2]
+    // extended_best_track_cands.latest(0) has 4 zones for road/pattern BX-0 (i.e. current) with possible tracks from [BX-2, BX-1, BX-0]
+    // extended_best_track_cands.latest(1) has 4 zones for road/pattern BX-1 with possible tracks from [BX-3, BX-2, BX-1]
+    // extended_best_track_cands.latest(2) has 4 zones for road/pattern BX-2 with possible tracks from [BX-4, BX-3, BX-2]
 
     for (int z = 0; z < max_z; ++z) {
-      const EMTFTrackCollection& tracks = extended_best_track_cands.at(h*max_z + z);
+      const EMTFTrackCollection& tracks = extended_best_track_cands.latest(h).at(z);
       const int ntracks = tracks.size();
       assert(ntracks <= max_n);
 
@@ -292,7 +295,7 @@ void BestTrackSelection::cancel_multi_bx(
         const int hzn = (h * max_z * max_n) + (n * max_z) + z;  // for (i = 0; i < 12; i = i+1) rank[i%4][i/4]
         const EMTFTrack& track = tracks.at(n);
         int cand_bx = track.Second_BX();
-        cand_bx -= (bx_ - delayBX);  // convert track.second_bx=[BX-2, BX-1, BX-0] --> cand_bx=[0,1,2]
+        cand_bx -= (bx - delayBX);  // convert track.second_bx=[BX-2, BX-1, BX-0] --> cand_bx=[0,1,2]
 
         rank.at(hzn) = track.Rank();
         if (cand_bx == 0)
@@ -453,7 +456,7 @@ void BestTrackSelection::cancel_multi_bx(
         n = (i / max_z) % max_n;
         z = i % max_z;
 
-        const EMTFTrackCollection& tracks = extended_best_track_cands.at(h*max_z + z);
+        const EMTFTrackCollection& tracks = extended_best_track_cands.latest(h).at(z);
         const EMTFTrack& track = tracks.at(n);
         best_tracks.push_back(track);
 
@@ -0,0 +1,85 @@
+#include "L1Trigger/L1TMuonEndCap/interface/ConvHitStore.h"
+
+
+void ConvHitStore::build(int bx, const BXWindow<EMTFHitCollection>& extended_conv_hits) {
+  // Function to update fs_history encoded in fs_segment
+  auto update_fs_history = [](int fs_segment, int this_bx, int hit_bx) {
+    // 0 for current BX, 1 for previous BX, 2 for BX before that
+    int fs_history = this_bx - hit_bx;
+    fs_segment |= ((fs_history & 0x3)<<4);
+    return fs_segment;
+  };
+
+  // Function to update bt_history encoded in bt_segment
+  auto update_bt_history = [](int bt_segment, int this_bx, int hit_bx) {
+    // 0 for current BX, 1 for previous BX, 2 for BX before that
+    int bt_history = this_bx - hit_bx;
+    bt_segment |= ((bt_history & 0x3)<<5);
+    return bt_segment;
+  };
+
+  // Keep the allocated capacity from the previous BXs
+  num_hits_ = 0;
+
+  for (auto& zhits : zone_hits_) {
+    zhits.layer.clear();
+    zhits.zone_hit.clear();
+  }
+
+  for (auto& zshits : zs_hits_) {
+    zshits.phi_fp.clear();
+    zshits.fs_segment.clear();
+    zshits.bt_segment.clear();
+    zshits.subsystem.clear();
+    zshits.hit.clear();
+  }
+
+  for (const auto& conv_hits : extended_conv_hits) {
+    num_hits_ += conv_hits.size();
+
+    for (const auto& conv_hit : conv_hits) {
+      assert(conv_hit.PC_segment() <= 4);  // With 2 unique LCTs per chamber, 4 possible strip/wire combinations
+
+      const int istation  = conv_hit.Station()-1;
+      const int subsystem = conv_hit.Subsystem();
+
+      // Zone images, from src/PatternRecognition.cc
+      // Don't use RPC and GEM hits for pattern formation
+      if (subsystem != TriggerPrimitive::kRPC && subsystem != TriggerPrimitive::kGEM) {
+        const int zone_code = conv_hit.Zone_code();
+
+        for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
+          if (zone_code & (1<<izone)) {  // hit belongs to this zone
+            zone_hits_.at(izone).layer.push_back(istation);
+            zone_hits_.at(izone).zone_hit.push_back(conv_hit.Zone_hit());
+          }
+        }
+      }
+
+      // Matching, from src/PrimitiveMatching.cc
+      // A hit can go into multiple zones
+      const int fs_zone_code = conv_hit.FS_zone_code();
+
+      for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
+        if (fs_zone_code & (1<<izone)) {
+          assert(conv_hit.Phi_fp() >= 0);
+
+          ZoneStationHits& zshits = zs_hits_.at((izone*emtf::NUM_STATIONS) + istation);
+          zshits.phi_fp.push_back(conv_hit.Phi_fp());
+          zshits.fs_segment.push_back(update_fs_history(conv_hit.FS_segment(), bx, conv_hit.BX()));
+          zshits.bt_segment.push_back(update_bt_history(conv_hit.BT_segment(), bx, conv_hit.BX()));
+          zshits.subsystem.push_back(subsystem);
+          zshits.hit.push_back(&conv_hit);
+        }
+      }
+    }  // end loop over conv_hits
+  }  // end loop over extended_conv_hits
+}
+
+EMTFHit ConvHitStore::ZoneStationHits::materialize(int ihit) const {
+  // This update only goes into the hits associated to a track, it does not affect the original hit collection
+  EMTFHit conv_hit = *hit.at(ihit);
+  conv_hit.set_fs_segment( fs_segment.at(ihit) );
+  conv_hit.set_bt_segment( bt_segment.at(ihit) );
+  return conv_hit;
+}
@@ -0,0 +1,286 @@
+#include "L1Trigger/L1TMuonEndCap/interface/EMTFPrimitiveIndex.h"
+
+#include "L1Trigger/L1TMuonEndCap/interface/TrackTools.h"
+
+#include "helper.h"  // assert_no_abort
+
+
+EMTFPrimitiveIndex::EMTFPrimitiveIndex() :
+    buckets_(),
+    occupancy_(),
+    empty_(),
+    minBX_(0), maxBX_(-1),
+    bxShiftCSC_(0), bxShiftRPC_(0), bxShiftGEM_(0)
+{
+
+}
+
+EMTFPrimitiveIndex::~EMTFPrimitiveIndex() {
+
+}
+
+void EMTFPrimitiveIndex::configure(
+    int minBX, int maxBX,
+    int bxShiftCSC, int bxShiftRPC, int bxShiftGEM
+) {
+  bxShiftCSC_ = bxShiftCSC;
+  bxShiftRPC_ = bxShiftRPC;
+  bxShiftGEM_ = bxShiftGEM;
+
+  minBX_      = minBX;
+  maxBX_      = maxBX;
+  resize();
+}
+
+void EMTFPrimitiveIndex::set_bx_range(int minBX, int maxBX) {
+  if (minBX_ == minBX && maxBX_ == maxBX)
+    return;
+
+  minBX_      = minBX;
+  maxBX_      = maxBX;
+  resize();
+}
+
+void EMTFPrimitiveIndex::resize() {
+  const int nbx = (maxBX_ - minBX_ + 1);
+  assert(nbx <= 64);  // fits the occupancy bitmap
+  buckets_.clear();
+  buckets_.resize(TriggerPrimitive::kNSubsystems * emtf::NUM_SECTORS * nbx);
+  occupancy_.fill(0);
+}
+
+void EMTFPrimitiveIndex::build(const TriggerPrimitiveCollection& muon_primitives) {
+  // Keep the allocated capacity from the previous event
+  for (auto& bucket : buckets_) {
+    bucket.clear();
+  }
+  occupancy_.fill(0);
+
+  auto get_next_sector = [](int sector) {
+    return (sector == 6) ? 1 : sector + 1;
+  };
+
+  auto get_prev_sector = [](int sector) {
+    return (sector == 1) ? 6 : sector - 1;
+  };
+
+  // The sectors are found as in the select_*() functions in src/PrimitiveSelection.cc.
+  // Each primitive is visited once here, so the format checks are done here too.
+  for (unsigned i = 0; i < muon_primitives.size(); ++i) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+
+    int tp_subsystem = tp.subsystem();
+    int tp_endcap    = 0;
+    int tp_sector    = 0;
+    int tp_bx        = 0;
+    int tp_neighbor  = 0;  // sector that also receives the primitive
+
+    if (tp_subsystem == TriggerPrimitive::kCSC) {
+      const CSCDetId& tp_detId = tp.detId<CSCDetId>();
+      const CSCData&  tp_data  = tp.getCSCData();
+
+      int tp_station = tp_detId.station();
+      int tp_ring    = tp_detId.ring();
+      int tp_csc_ID  = tp_data.cscID;
+
+      int max_strip = 0;  // halfstrip
+      int max_wire  = 0;  // wiregroup
+      emtf::get_csc_max_strip_and_wire(tp_station, tp_ring, max_strip, max_wire);
+
+      tp_endcap   = tp_detId.endcap();
+      tp_sector   = tp_detId.triggerSector();
+      tp_bx       = tp_data.bx + bxShiftCSC_;
+      tp_neighbor = get_next_sector(tp_sector);
+
+      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
+      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
+      assert_no_abort(1 <= tp_station && tp_station <= 4);
+      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 9);
+      assert_no_abort(tp_data.strip < max_strip);
+      assert_no_abort(tp_data.keywire < max_wire);
+      assert_no_abort(tp_data.valid == true);
+      assert_no_abort(tp_data.pattern <= 10);
+      //assert_no_abort(tp_data.quality > 0);
+
+    } else if (tp_subsystem == TriggerPrimitive::kRPC) {
+      const RPCDetId& tp_detId = tp.detId<RPCDetId>();
+      const RPCData&  tp_data  = tp.getRPCData();
+
+      int tp_region    = tp_detId.region();     // 0 for Barrel, +/-1 for +/- Endcap
+      int tp_subsector = tp_detId.subsector();
+      int tp_station   = tp_detId.station();
+      int tp_ring      = tp_detId.ring();
+      int tp_roll      = tp_detId.roll();
+      int tp_strip     = tp_data.strip;
+      bool tp_CPPF     = tp_data.isCPPF;
+
+      const bool is_irpc = (tp_station == 3 || tp_station == 4) && (tp_ring == 1);
+
+      tp_endcap   = (tp_region == -1) ? 2 : tp_region;
+      tp_sector   = tp_detId.sector();
+      tp_bx       = tp_data.bx + bxShiftRPC_;
+      // RPC subsectors 1-2 (iRPC subsector 1) belong to the previous CSC sector,
+      // and the neighbor chamber is used by the sector with the same number
+      tp_neighbor = get_prev_sector(tp_sector);
+
+      assert_no_abort(tp_region != 0);
+      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
+      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
+      assert_no_abort(1 <= tp_subsector && tp_subsector <= 6);
+      assert_no_abort(1 <= tp_station && tp_station <= 4);
+      assert_no_abort((!is_irpc && 2 <= tp_ring && tp_ring <= 3) || (is_irpc && tp_ring == 1));
+      assert_no_abort((!is_irpc && 1 <= tp_roll && tp_roll <= 3) || (is_irpc && 1 <= tp_roll && tp_roll <= 5));
+      //assert_no_abort((!is_irpc && (tp_CPPF || (1 <= tp_strip && tp_strip <= 32))) || (is_irpc && 1 <= tp_strip && tp_strip <= 96));
+      assert_no_abort((!is_irpc && (tp_CPPF || (1 <= tp_strip && tp_strip <= 32))) || (is_irpc && 1 <= tp_strip && tp_strip <= 96*2));  // in CMSSW, the iRPC chamber has 192 strips
+      //assert_no_abort(tp_station > 2 || tp_ring != 3);  // stations 1 and 2 do not receive RPCs from ring 3
+      assert_no_abort(tp_data.valid == true);
+
+    } else if (tp_subsystem == TriggerPrimitive::kGEM) {
+      const GEMDetId& tp_detId = tp.detId<GEMDetId>();
+      const GEMData&  tp_data  = tp.getGEMData();
+
+      int tp_region  = tp_detId.region();     // 0 for Barrel, +/-1 for +/- Endcap
+      int tp_station = tp_detId.station();
+      int tp_ring    = tp_detId.ring();
+      int tp_roll    = tp_detId.roll();
+      int tp_layer   = tp_detId.layer();
+      int tp_chamber = tp_detId.chamber();
+      int tp_pad     = ((tp_data.pad_low + tp_data.pad_hi) / 2);
+      int tp_csc_ID  = emtf::get_trigger_csc_ID(tp_ring, tp_station, tp_chamber);
+
+      tp_endcap   = (tp_region == -1) ? 2 : tp_region;
+      tp_sector   = emtf::get_trigger_sector(tp_ring, tp_station, tp_chamber);
+      tp_bx       = tp_data.bx + bxShiftGEM_;
+      tp_neighbor = get_next_sector(tp_sector);
+
+      assert_no_abort(tp_region != 0);
+      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
+      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
+      assert_no_abort(1 <= tp_station && tp_station <= 2);
+      assert_no_abort(tp_ring == 1);
+      assert_no_abort(1 <= tp_roll && tp_roll <= 8);
+      assert_no_abort(1 <= tp_layer && tp_layer <= 2);
+      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 3);
+      assert_no_abort((tp_station == 1 && 1 <= tp_pad && tp_pad <= 192) || (tp_station != 1));
+      assert_no_abort((tp_station == 2 && 1 <= tp_pad && tp_pad <= 384) || (tp_station != 2));
+
+    } else if (tp_subsystem == TriggerPrimitive::kME0) {
+      const ME0DetId& tp_detId = tp.detId<ME0DetId>();
+      const ME0Data&  tp_data  = tp.getME0Data();
+
+      int tp_region  = tp_detId.region();     // 0 for Barrel, +/-1 for +/- Endcap
+      int tp_station = tp_detId.station();
+      int tp_ring    = 1;  // tp_detId.ring() does not exist
+      int tp_roll    = tp_detId.roll();
+      int tp_chamber = tp_detId.chamber();
+      int tp_pad     = tp_data.pad;
+      int tp_csc_ID  = emtf::get_trigger_csc_ID(1, 2, tp_chamber);
+
+      // The ME0 geometry is similar to ME2/1, see PrimitiveSelection::select_me0()
+      tp_endcap   = (tp_region == -1) ? 2 : tp_region;
+      tp_sector   = emtf::get_trigger_sector(1, 2, tp_chamber);
+      tp_bx       = tp_data.bx + bxShiftGEM_;
+      tp_neighbor = get_next_sector(tp_sector);
+
+      assert_no_abort(tp_region != 0);
+      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
+      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
+      assert_no_abort(tp_station == 1);
+      assert_no_abort(tp_ring == 1);
+      assert_no_abort(1 <= tp_roll && tp_roll <= 8);
+      //assert_no_abort(1 <= tp_layer && tp_layer <= 6);  // it is currently not set
+      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 3);
+      assert_no_abort(1 <= tp_pad && tp_pad <= 192);
+
+    } else if (tp_subsystem == TriggerPrimitive::kDT) {
+      const DTChamberId& tp_detId = tp.detId<DTChamberId>();
+      const DTData&      tp_data  = tp.getDTData();
+
+      int tp_wheel   = tp_detId.wheel();
+      int tp_station = tp_detId.station();
+      int dt_sector  = tp_detId.sector();  // DT sector, 1-12
+      if (tp_station == 4) {
+        if (dt_sector == 13)
+          dt_sector = 4;
+        else if (dt_sector == 14)
+          dt_sector = 10;
+      }
+      int tp_phi     = tp_data.radialAngle;
+      int tp_phiB    = tp_data.bendingAngle;
+      int tp_chamber = dt_sector * 3 - 1;  // see PrimitiveSelection::select_dt()
+      int tp_csc_ID  = emtf::get_trigger_csc_ID(2, 2, tp_chamber);
+
+      tp_endcap   = (tp_wheel > 0) ? 1 : ((tp_wheel < 0) ? 2 : 0);
+      tp_sector   = emtf::get_trigger_sector(2, 2, tp_chamber);
+      tp_bx       = tp_data.bx;
+      tp_neighbor = get_next_sector(tp_sector);
+
+      //assert_no_abort(-2 <= tp_wheel && tp_wheel <= +2);
+      assert_no_abort(tp_wheel == -2 || tp_wheel == +2);  // do not include wheels -1, 0, +1
+      //assert_no_abort(1 <= tp_station && tp_station <= 4);
+      assert_no_abort(1 <= tp_station && tp_station <= 3);  // do not include MB4
+      assert_no_abort(1 <= dt_sector && dt_sector <= 12);
+      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
+      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
+      //assert_no_abort(4 <= tp_csc_ID && tp_csc_ID <= 9);
+      assert_no_abort(tp_csc_ID == 6 || tp_csc_ID == 9);
+      assert_no_abort(-2048 <= tp_phi && tp_phi <= 2047);  // 12-bit
+      assert_no_abort(-512 <= tp_phiB && tp_phiB <= 511);  // 10-bit
+
+    } else {
+      continue;
+    }
+
+    bool inserted = false;
+    inserted |= insert(tp_subsystem, tp_endcap, tp_sector, tp_bx, i);
+    inserted |= insert(tp_subsystem, tp_endcap, tp_neighbor, tp_bx, i);  // as neighbor
+
+    if (!inserted) {
+      edm::LogWarning("L1T") << "EMTF primitive not used by any sector processor: subsystem " << tp_subsystem
+        << ", endcap " << tp_endcap << ", sector " << tp_sector << ", bx " << tp_bx
+        << " (BX range = [" << minBX_ << ", " << maxBX_ << "])";
+    }
+  }  // end loop over muon_primitives
+}
+
+const EMTFPrimitiveIndex::index_list_t& EMTFPrimitiveIndex::get(int subsystem, int endcap, int sector, int bx) const {
+  int ibucket = get_bucket(subsystem, endcap, sector, bx);
+  if (ibucket < 0)
+    return empty_;
+  return buckets_.at(ibucket);
+}
+
+bool EMTFPrimitiveIndex::insert(int subsystem, int endcap, int sector, int bx, unsigned index) {
+  int ibucket = get_bucket(subsystem, endcap, sector, bx);
+  if (ibucket < 0)  // not used by any sector processor
+    return false;
+  buckets_.at(ibucket).push_back(index);
+
+  const int es = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+  occupancy_.at(es) |= (uint64_t(1) << (bx - minBX_));
+  return true;
+}
+
+bool EMTFPrimitiveIndex::is_occupied(int endcap, int sector, int bx) const {
+  // Any subsystem will do, the bucket is only used for the range checks
+  if (get_bucket(0, endcap, sector, bx) < 0)
+    return true;  // not indexed, cannot tell
+
+  const int es = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+  return (occupancy_.at(es) >> (bx - minBX_)) & 1;
+}
+
+int EMTFPrimitiveIndex::get_bucket(int subsystem, int endcap, int sector, int bx) const {
+  if (!(0 <= subsystem && subsystem < TriggerPrimitive::kNSubsystems))
+    return -1;
+  if (!(emtf::MIN_ENDCAP <= endcap && endcap <= emtf::MAX_ENDCAP))
+    return -1;
+  if (!(emtf::MIN_TRIGSECTOR <= sector && sector <= emtf::MAX_TRIGSECTOR))
+    return -1;
+  if (!(minBX_ <= bx && bx <= maxBX_))
+    return -1;
+
+  const int es  = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+  const int nbx = (maxBX_ - minBX_ + 1);
+  return ((subsystem * emtf::NUM_SECTORS) + es) * nbx + (bx - minBX_);
+}
@@ -22,6 +22,15 @@
 
 using namespace L1TMuonEndCap;
 
+namespace {
+  // Stop adding to the cache beyond this size, to bound the memory in long jobs
+  constexpr size_t max_point_cache_size = 1 << 20;
+
+  uint64_t make_point_key(uint32_t rawId, uint32_t position) {
+    return (static_cast<uint64_t>(rawId) << 32) | position;
+  }
+}
+
 GeometryTranslator::GeometryTranslator():
   _geom_cache_id(0ULL), _magfield_cache_id(0ULL) {
 }
@@ -29,6 +38,20 @@ GeometryTranslator::GeometryTranslator():
 GeometryTranslator::~GeometryTranslator() {
 }
 
+template<typename F>
+GlobalPoint
+GeometryTranslator::getCachedPoint(uint64_t key, F compute) const {
+  point_cache_t::const_iterator found = _point_cache.find(key);
+  if (found != _point_cache.end())
+    return found->second;
+
+  // Another thread may compute the same point at the same time; both get the same value
+  const GlobalPoint gp = compute();
+  if (_point_cache.size() < max_point_cache_size)
+    _point_cache.insert(std::make_pair(key, gp));
+  return gp;
+}
+
 double
 GeometryTranslator::calculateGlobalEta(const TriggerPrimitive& tp) const {
   switch(tp.subsystem()) {
@@ -136,6 +159,7 @@ void GeometryTranslator::checkAndUpdateGeometry(const edm::EventSetup& es) {
     geom.get(_geocsc);
     geom.get(_geodt);
     _geom_cache_id = geomid;
+    _point_cache.clear();
   }
 
   const IdealMagneticFieldRecord& magfield = es.get<IdealMagneticFieldRecord>();
@@ -177,6 +201,14 @@ GeometryTranslator::calcME0SpecificBend(const TriggerPrimitive& tp) const {
 // GEM
 GlobalPoint
 GeometryTranslator::getGEMSpecificPoint(const TriggerPrimitive& tp) const {
+  const uint32_t position = tp.getGEMData().pad_low + tp.getGEMData().pad_hi;
+  return getCachedPoint(make_point_key(tp.rawId().rawId(), position), [&]() {
+    return calcGEMSpecificPoint(tp);
+  });
+}
+
+GlobalPoint
+GeometryTranslator::calcGEMSpecificPoint(const TriggerPrimitive& tp) const {
   const GEMDetId id(tp.detId<GEMDetId>());
   const GEMEtaPartition * roll = _geogem->etaPartition(id);
   assert(roll != nullptr);  // failed to get GEM roll
@@ -207,6 +239,14 @@ GeometryTranslator::calcGEMSpecificBend(const TriggerPrimitive& tp) const {
 // RPC
 GlobalPoint
 GeometryTranslator::getRPCSpecificPoint(const TriggerPrimitive& tp) const {
+  const uint32_t position = tp.getRPCData().strip_low + tp.getRPCData().strip_hi;
+  return getCachedPoint(make_point_key(tp.rawId().rawId(), position), [&]() {
+    return calcRPCSpecificPoint(tp);
+  });
+}
+
+GlobalPoint
+GeometryTranslator::calcRPCSpecificPoint(const TriggerPrimitive& tp) const {
   // Note: For iRPC, it is calculated separately in the EMTF emulator using
   // the local position (tp.getRPCData().x & tp.getRPCData().y)
   const RPCDetId id(tp.detId<RPCDetId>());
@@ -246,6 +286,31 @@ GeometryTranslator::calcRPCSpecificBend(const TriggerPrimitive& tp) const {
 // rather than using the old phi luts
 GlobalPoint
 GeometryTranslator::getCSCSpecificPoint(const TriggerPrimitive& tp) const {
+  // The point only depends on the chamber, the halfstrip after the pattern offset and the wiregroup
+  const unsigned halfstrip_offs = getCSCHalfStripOffset(tp);
+  const uint32_t position = (halfstrip_offs << 16) | tp.getCSCData().keywire;
+  return getCachedPoint(make_point_key(tp.rawId().rawId(), position), [&]() {
+    return calcCSCSpecificPoint(tp, halfstrip_offs);
+  });
+}
+
+unsigned
+GeometryTranslator::getCSCHalfStripOffset(const TriggerPrimitive& tp) const {
+  const uint16_t halfstrip = tp.getCSCData().strip;
+  const uint16_t pattern = tp.getCSCData().pattern;
+
+  // so we can extend this later
+  // assume TMB2007 half-strips only as baseline
+  double offset = 0.0;
+  switch(1) {
+  case 1:
+    offset = CSCPatternLUT::get2007Position(pattern);
+  }
+  return static_cast<unsigned>(0.5 + halfstrip + offset);
+}
+
+GlobalPoint
+GeometryTranslator::calcCSCSpecificPoint(const TriggerPrimitive& tp, unsigned halfstrip_offs) const {
   const CSCDetId id(tp.detId<CSCDetId>());
   // we should change this to weak_ptrs at some point
   // requires introducing std::shared_ptrs to geometry
@@ -258,19 +323,9 @@ GeometryTranslator::getCSCSpecificPoint(const TriggerPrimitive& tp) const {
     chamb->layer(CSCConstants::KEY_ALCT_LAYER)
     );
 
-  const uint16_t halfstrip = tp.getCSCData().strip;
-  const uint16_t pattern = tp.getCSCData().pattern;
   const uint16_t keyWG = tp.getCSCData().keywire;
   //const unsigned maxStrips = layer_geom->numberOfStrips();
 
-  // so we can extend this later
-  // assume TMB2007 half-strips only as baseline
-  double offset = 0.0;
-  switch(1) {
-  case 1:
-    offset = CSCPatternLUT::get2007Position(pattern);
-  }
-  const unsigned halfstrip_offs = static_cast<unsigned>(0.5 + halfstrip + offset);
   const unsigned strip = halfstrip_offs/2 + 1; // geom starts from 1
 
   // the rough location of the hit at the ALCT key layer
@@ -336,6 +391,24 @@ isCSCCounterClockwise(const std::unique_ptr<const CSCLayer>& layer) const {
 // DT
 GlobalPoint
 GeometryTranslator::calcDTSpecificPoint(const TriggerPrimitive& tp) const {
+  // Only theta depends on the geometry, through the chamber and the theta BTI group
+  const DTChamberId baseid(tp.detId<DTChamberId>());
+  const uint32_t position = static_cast<uint16_t>(tp.getDTData().theta_bti_group);
+  const GlobalPoint& theta_gp = getCachedPoint(make_point_key(baseid.rawId(), position), [&]() {
+    return calcDTSpecificThetaPoint(tp);
+  });
+
+  // local phi in sector -> global phi
+  double phi = static_cast<double>(tp.getDTData().radialAngle)/4096.0;  // 12 bits for 1 radian
+  phi += tp.getDTData().sector*M_PI/6.0; // add sector offset, sector is [0,11]
+
+  return GlobalPoint( GlobalPoint::Polar( theta_gp.theta(),
+                                          phi,
+                                          theta_gp.mag() ) );
+}
+
+GlobalPoint
+GeometryTranslator::calcDTSpecificThetaPoint(const TriggerPrimitive& tp) const {
   const DTChamberId baseid(tp.detId<DTChamberId>());
   // do not use this pointer for anything other than creating a trig geom
   std::unique_ptr<DTChamber> chamb(
@@ -362,14 +435,7 @@ GeometryTranslator::calcDTSpecificPoint(const TriggerPrimitive& tp) const {
     thetaBTI = DTBtiId(baseid,3,1);
   }
   const GlobalPoint& theta_gp = trig_geom->CMSPosition(thetaBTI);
-
-  // local phi in sector -> global phi
-  double phi = static_cast<double>(tp.getDTData().radialAngle)/4096.0;  // 12 bits for 1 radian
-  phi += tp.getDTData().sector*M_PI/6.0; // add sector offset, sector is [0,11]
-
-  return GlobalPoint( GlobalPoint::Polar( theta_gp.theta(),
-                                          phi,
-                                          theta_gp.mag() ) );
+  return theta_gp;
 }
 
 double
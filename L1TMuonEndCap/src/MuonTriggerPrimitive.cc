@@ -30,6 +30,7 @@ namespace {
 TriggerPrimitive::TriggerPrimitive(const DTChamberId& detid,
                                    const L1MuDTChambPhDigi& digi_phi,
                                    const int segment_number):
+  _dt(),
   _id(detid),
   _subsystem(TriggerPrimitive::kDT) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -55,6 +56,7 @@ TriggerPrimitive::TriggerPrimitive(const DTChamberId& detid,
 TriggerPrimitive::TriggerPrimitive(const DTChamberId& detid,
                                    const L1MuDTChambThDigi& digi_th,
                                    const int theta_bti_group):
+  _dt(),
   _id(detid),
   _subsystem(TriggerPrimitive::kDT) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -81,6 +83,7 @@ TriggerPrimitive::TriggerPrimitive(const DTChamberId& detid,
                                    const L1MuDTChambPhDigi& digi_phi,
                                    const L1MuDTChambThDigi& digi_th,
                                    const int theta_bti_group):
+  _dt(),
   _id(detid),
   _subsystem(TriggerPrimitive::kDT) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -106,6 +109,7 @@ TriggerPrimitive::TriggerPrimitive(const DTChamberId& detid,
 //constructor from CSC data
 TriggerPrimitive::TriggerPrimitive(const CSCDetId& detid,
                                    const CSCCorrelatedLCTDigi& digi):
+  _csc(),
   _id(detid),
   _subsystem(TriggerPrimitive::kCSC) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -140,6 +144,7 @@ TriggerPrimitive::TriggerPrimitive(const CSCDetId& detid,
 // constructor from RPC data
 TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
                                    const RPCDigi& digi):
+  _rpc(),
   _id(detid),
   _subsystem(TriggerPrimitive::kRPC) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -160,6 +165,7 @@ TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
 
 TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
                                    const RPCRecHit& rechit):
+  _rpc(),
   _id(detid),
   _subsystem(TriggerPrimitive::kRPC) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -181,6 +187,7 @@ TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
 // constructor from CPPF data
 TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
                                    const l1t::CPPFDigi& digi):
+  _rpc(),
   _id(detid),
   _subsystem(TriggerPrimitive::kRPC) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -203,6 +210,7 @@ TriggerPrimitive::TriggerPrimitive(const RPCDetId& detid,
 // constructor from GEM data
 TriggerPrimitive::TriggerPrimitive(const GEMDetId& detid,
                                    const GEMPadDigi& digi):
+  _gem(),
   _id(detid),
   _subsystem(TriggerPrimitive::kGEM) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -222,6 +230,7 @@ TriggerPrimitive::TriggerPrimitive(const GEMDetId& detid,
 TriggerPrimitive::TriggerPrimitive(const ME0DetId& detid,
                                    const ME0Segment& rechit,
                                    const ME0Geometry& geom):
+  _me0(),
   _id(detid),
   _subsystem(TriggerPrimitive::kME0) {
   calculateGlobalSector(detid,_globalsector,_subsector);
@@ -248,40 +257,6 @@ TriggerPrimitive::TriggerPrimitive(const ME0DetId& detid,
   _me0.bx = static_cast<int>(std::round(_me0.time/25.));  // 1BX = 25ns
 }
 
-// copy constructor
-TriggerPrimitive::TriggerPrimitive(const TriggerPrimitive& tp):
-  _dt(tp._dt),
-  _csc(tp._csc),
-  _rpc(tp._rpc),
-  _gem(tp._gem),
-  _me0(tp._me0),
-  _id(tp._id),
-  _subsystem(tp._subsystem),
-  _globalsector(tp._globalsector),
-  _subsector(tp._subsector),
-  _eta(tp._eta),
-  _phi(tp._phi),
-  _rho(tp._rho),
-  _theta(tp._theta){
-}
-
-TriggerPrimitive& TriggerPrimitive::operator=(const TriggerPrimitive& tp) {
-  this->_dt = tp._dt;
-  this->_csc = tp._csc;
-  this->_rpc = tp._rpc;
-  this->_gem = tp._gem;
-  this->_me0 = tp._me0;
-  this->_id = tp._id;
-  this->_subsystem = tp._subsystem;
-  this->_globalsector = tp._globalsector;
-  this->_subsector = tp._subsector;
-  this->_eta = tp._eta;
-  this->_phi = tp._phi;
-  this->_rho = tp._rho;
-  this->_theta = tp._theta;
-  return *this;
-}
-
 bool TriggerPrimitive::operator==(const TriggerPrimitive& tp) const {
   // Copied from Numpy
   // https://github.com/numpy/numpy/blob/v1.14.0/numpy/core/numeric.py#L2260-L2355
@@ -289,6 +264,10 @@ bool TriggerPrimitive::operator==(const TriggerPrimitive& tp) const {
     return std::abs(a-b) <= (atol + rtol * std::abs(b));
   };
 
+  // The subsystem data is only comparable for the same subsystem
+  if (this->_subsystem != tp._subsystem)
+    return false;
+
   switch(_subsystem) {
   case kDT:
     return  ( this->_dt.bx == tp._dt.bx &&
@@ -1,16 +1,47 @@
 #include "L1Trigger/L1TMuonEndCap/interface/PatternRecognition.h"
 
+#include <limits>
+
 #include "helper.h"  // to_hex, to_binary
 
 namespace {
   const int padding_w_st1 = 15;
   const int padding_w_st3 = 7;
   const int padding_extra_w_st1 = padding_w_st1 - padding_w_st3;
+
+  // One layer of a PhiMemoryImage: 3 x 64 bits, rotations wrap around
+  typedef std::array<PhiMemoryImage::value_type, 3> zone_row_t;
+  const int zone_row_bits = 3 * 64;
+  const int zone_row_levels = 8;  // dilations by 1, 2, 4, ..., 128 bits
+
+  // Bit i of the result is bit (i+n) of x
+  zone_row_t rotr_row(const zone_row_t& x, int n) {
+    n = ((n % zone_row_bits) + zone_row_bits) % zone_row_bits;
+    const int q = n / 64;
+    const int r = n % 64;
+    zone_row_t y;
+    for (int j = 0; j < 3; ++j) {
+      y[j] = x[(j+q) % 3] >> r;
+      if (r != 0)
+        y[j] |= x[(j+q+1) % 3] << (64-r);
+    }
+    return y;
+  }
+
+  void or_row(zone_row_t& x, const zone_row_t& y) {
+    x[0] |= y[0];
+    x[1] |= y[1];
+    x[2] |= y[2];
+  }
+
+  bool test_row(const zone_row_t& x, int i) {
+    return (x[i / 64] >> (i % 64)) & 1;
+  }
 }
 
 
 void PatternRecognition::configure(
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     int bxWindow,
     const std::vector<std::string>& pattDefinitions, const std::vector<std::string>& symPattDefinitions, bool useSymPatterns,
     int maxRoadsPerZone, bool useSecondEarliest
@@ -18,7 +49,6 @@ void PatternRecognition::configure(
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   bxWindow_           = bxWindow;
   pattDefinitions_    = pattDefinitions;
@@ -166,6 +196,38 @@ void PatternRecognition::configure_details() {
     assert(patterns_.size() == symPattDefinitions_.size());
   }
 
+  // Split each layer of each pattern into runs of consecutive bits. The
+  // image is circular, so a run can wrap around from the last bit to bit 0.
+  pattern_windows_.clear();
+  max_window_level_ = 0;
+
+  for (const auto& pattern : patterns_) {
+    std::vector<PatternWindow> windows;
+
+    for (int layer = 0; layer < 4; ++layer) {
+      for (int bit = 0; bit < zone_row_bits; ++bit) {
+        bool is_first = pattern.test_bit(layer, bit) && !pattern.test_bit(layer, (bit + zone_row_bits - 1) % zone_row_bits);
+        if (!is_first)
+          continue;
+
+        int width = 1;
+        while (width < zone_row_bits && pattern.test_bit(layer, (bit + width) % zone_row_bits))
+          ++width;
+
+        int level = 0;
+        while ((2 << level) <= width)
+          ++level;
+
+        windows.push_back({layer, bit - padding_w_st3, width, level});
+        max_window_level_ = std::max(max_window_level_, level);
+      }
+    }
+    pattern_windows_.push_back(windows);
+  }
+  assert(pattern_windows_.size() == patterns_.size());
+  assert(patterns_.size() <= PatternLifetime::MAX_PATTERNS);
+  assert(max_window_level_ < zone_row_levels);
+
   if (verbose_ > 2) {  // debug
     for (const auto& pattern : patterns_) {
       std::cout << "Pattern straightness: " << pattern.get_straightness() << " image: " << std::endl;
@@ -175,15 +237,15 @@ void PatternRecognition::configure_details() {
 }
 
 void PatternRecognition::process(
-    const std::deque<EMTFHitCollection>& extended_conv_hits,
-    std::map<pattern_ref_t, int>& patt_lifetime_map,
+    int bx,
+    const BXWindow<EMTFHitCollection>& extended_conv_hits,
+    const ConvHitStore& conv_hit_store,
+    PatternLifetime& patt_lifetime,
     emtf::zone_array<EMTFRoadCollection>& zone_roads
 ) const {
   // Exit if no hits
-  int num_conv_hits = 0;
-  for (const auto& conv_hits : extended_conv_hits)
-    num_conv_hits += conv_hits.size();
-  bool early_exit = (num_conv_hits == 0) && (patt_lifetime_map.empty());
+  int num_conv_hits = conv_hit_store.num_hits();
+  bool early_exit = (num_conv_hits == 0) && (patt_lifetime.empty());
 
   if (early_exit)
     return;
@@ -234,14 +296,14 @@ void PatternRecognition::process(
 
   for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
     // Skip the zone if no hits and no patterns
-    if (is_zone_empty(izone+1, extended_conv_hits, patt_lifetime_map))
+    if (is_zone_empty(izone+1, conv_hit_store, patt_lifetime))
       continue;
 
     // Make zone images
-    make_zone_image(izone+1, extended_conv_hits, zone_images.at(izone));
+    make_zone_image(izone+1, conv_hit_store, zone_images.at(izone));
 
     // Detect patterns
-    process_single_zone(izone+1, zone_images.at(izone), patt_lifetime_map, zone_roads.at(izone));
+    process_single_zone(izone+1, bx, zone_images.at(izone), patt_lifetime, zone_roads.at(izone));
   }
 
   if (verbose_ > 2) {  // debug
@@ -249,9 +311,6 @@ void PatternRecognition::process(
       std::cout << "zone: " << izone << std::endl;
       std::cout << zone_images.at(izone-1) << std::endl;
     }
-    //for (const auto& kv : patt_lifetime_map) {
-    //  std::cout << "zone: " << kv.first.at(0) << " izhit: " << kv.first.at(1) << " ipatt: " << kv.first.at(2) << " lifetime: " << kv.second << std::endl;
-    //}
   }
 
   if (verbose_ > 0) {  // debug
@@ -274,81 +333,36 @@ void PatternRecognition::process(
 
 bool PatternRecognition::is_zone_empty(
     int zone,
-    const std::deque<EMTFHitCollection>& extended_conv_hits,
-    const std::map<pattern_ref_t, int>& patt_lifetime_map
+    const ConvHitStore& conv_hit_store,
+    const PatternLifetime& patt_lifetime
 ) const {
   int izone = zone-1;
-  int num_conv_hits = 0;
-  int num_patts = 0;
-
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_it  = extended_conv_hits.begin();
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_end = extended_conv_hits.end();
-
-  for (; ext_conv_hits_it != ext_conv_hits_end; ++ext_conv_hits_it) {
-    EMTFHitCollection::const_iterator conv_hits_it  = ext_conv_hits_it->begin();
-    EMTFHitCollection::const_iterator conv_hits_end = ext_conv_hits_it->end();
-
-    for (; conv_hits_it != conv_hits_end; ++conv_hits_it) {
-      assert(conv_hits_it->PC_segment() <= 4);  // With 2 unique LCTs per chamber, 4 possible strip/wire combinations
-
-      if (conv_hits_it->Subsystem() == TriggerPrimitive::kRPC)
-        continue;  // Don't use RPC hits for pattern formation
-
-      if (conv_hits_it->Subsystem() == TriggerPrimitive::kGEM)
-        continue;  // Don't use GEM hits for pattern formation
-
-      if (conv_hits_it->Zone_code() & (1 << izone)) {  // hit belongs to this zone
-        num_conv_hits += 1;
-      }
-    }  // end loop over conv_hits
-  }  // end loop over extended_conv_hits
+  int num_conv_hits = conv_hit_store.zone_hits(izone).size();
 
-  std::map<pattern_ref_t, int>::const_iterator patt_lifetime_map_it  = patt_lifetime_map.begin();
-  std::map<pattern_ref_t, int>::const_iterator patt_lifetime_map_end = patt_lifetime_map.end();
-
-  for (; patt_lifetime_map_it != patt_lifetime_map_end; ++patt_lifetime_map_it) {
-    if (patt_lifetime_map_it->first.at(0) == zone) {
-      num_patts += 1;
-    }
-  }  // end loop over patt_lifetime_map
-
-  return (num_conv_hits == 0) && (num_patts == 0);
+  return (num_conv_hits == 0) && patt_lifetime.is_zone_empty(izone);
 }
 
 void PatternRecognition::make_zone_image(
     int zone,
-    const std::deque<EMTFHitCollection>& extended_conv_hits,
+    const ConvHitStore& conv_hit_store,
     PhiMemoryImage& image
 ) const {
   int izone = zone-1;
 
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_it  = extended_conv_hits.begin();
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_end = extended_conv_hits.end();
-
-  for (; ext_conv_hits_it != ext_conv_hits_end; ++ext_conv_hits_it) {
-    EMTFHitCollection::const_iterator conv_hits_it  = ext_conv_hits_it->begin();
-    EMTFHitCollection::const_iterator conv_hits_end = ext_conv_hits_it->end();
-
-    for (; conv_hits_it != conv_hits_end; ++conv_hits_it) {
-      if (conv_hits_it->Subsystem() == TriggerPrimitive::kRPC)
-        continue;  // Don't use RPC hits for pattern formation
-
-      if (conv_hits_it->Subsystem() == TriggerPrimitive::kGEM)
-        continue;  // Don't use GEM hits for pattern formation
+  // The hits of this zone, without RPC and GEM hits
+  const ConvHitStore::ZoneHits& zone_hits = conv_hit_store.zone_hits(izone);
 
-      if (conv_hits_it->Zone_code() & (1 << izone)) {  // hit belongs to this zone
-        unsigned int layer = conv_hits_it->Station() - 1;
-        unsigned int bit   = conv_hits_it->Zone_hit();
-        image.set_bit(layer, bit);
-      }
-    }  // end loop over conv_hits
-  }  // end loop over extended_conv_hits
+  for (int ihit = 0; ihit < zone_hits.size(); ++ihit) {
+    unsigned int layer = zone_hits.layer[ihit];
+    unsigned int bit   = zone_hits.zone_hit[ihit];
+    image.set_bit(layer, bit);
+  }
 }
 
 void PatternRecognition::process_single_zone(
-    int zone,
-    PhiMemoryImage cloned_image,
-    std::map<pattern_ref_t, int>& patt_lifetime_map,
+    int zone, int bx,
+    const PhiMemoryImage& image,
+    PatternLifetime& patt_lifetime,
     EMTFRoadCollection& roads
 ) const {
   roads.clear();
@@ -356,15 +370,54 @@ void PatternRecognition::process_single_zone(
   const int drift_time = bxWindow_ - 1;
   const int npatterns = patterns_.size();
 
-  // The zone hit image is rotated/shifted before comparing with patterns
-  // First, rotate left/shift up to the zone hit in the key station
-  cloned_image.rotl(padding_w_st3);
+  // This is equivalent to rotating the zone image to every zone hit and
+  // comparing it with every pattern (PhiMemoryImage::op_and), but the hits
+  // in the pattern windows are found for all the zone hits at once.
+  // dilated[layer][k] has bit i set if any of the bits [i, i+2^k) of the
+  // layer is set. A window of width w in [2^k, 2^(k+1)) starting at shift s
+  // is covered by dilated[k] rotated by s and by s+w-2^k.
+  std::array<std::array<zone_row_t, zone_row_levels>, 4> dilated;
+
+  for (int layer = 0; layer < 4; ++layer) {
+    for (int unit = 0; unit < 3; ++unit)
+      dilated[layer][0][unit] = image.get_word(layer, unit);
+
+    for (int level = 1; level <= max_window_level_; ++level) {
+      dilated[layer][level] = dilated[layer][level-1];
+      or_row(dilated[layer][level], rotr_row(dilated[layer][level-1], 1 << (level-1)));
+    }
+  }
+
+  // Layer code bits of each pattern at every zone hit: [st1, st2, st3 or st4]
+  std::vector<std::array<zone_row_t, 3> > layer_hits(npatterns);
+  zone_row_t any_hits = {{0, 0, 0}};
+
+  for (int ipatt = 0; ipatt < npatterns; ++ipatt) {
+    std::array<zone_row_t, 3>& patt_hits = layer_hits.at(ipatt);
+    for (auto& row : patt_hits)
+      row.fill(0);
+
+    for (const auto& w : pattern_windows_.at(ipatt)) {
+      const zone_row_t& d = dilated[w.layer][w.level];
+      zone_row_t& row = patt_hits[std::min(w.layer, 2)];
+      or_row(row, rotr_row(d, w.shift));
+      or_row(row, rotr_row(d, w.shift + w.width - (1 << w.level)));
+    }
+
+    for (const auto& row : patt_hits)
+      or_row(any_hits, row);
+  }
+
+  // Zone hits with patterns that are still alive from the previous BX
+  const int izone = zone-1;
+  const zone_row_t any_alive = patt_lifetime.alive(izone);
 
   for (int izhit = 0; izhit < emtf::NUM_ZONE_HITS; ++izhit) {
-    // The zone hit image is rotated/shift before comparing with patterns
-    // For every zone hit, rotate right/shift down by one
-    if (izhit > 0)
-      cloned_image.rotr(1);
+    // Nothing to insert, update or erase
+    if (!test_row(any_hits, izhit) && !test_row(any_alive, izhit))
+      continue;
+
+    bool is_alive = false;
 
     int max_quality_code = -1;
     EMTFRoad tmp_road;
@@ -377,32 +430,31 @@ void PatternRecognition::process_single_zone(
 
       bool is_lifetime_up = false;
 
-      int layer_code = patt.op_and(cloned_image);  // kind of like AND operator
+      const std::array<zone_row_t, 3>& patt_hits = layer_hits.at(ipatt);
+      int layer_code = (test_row(patt_hits[0], izhit) << 2) | (test_row(patt_hits[1], izhit) << 1) | (test_row(patt_hits[2], izhit) << 0);
       bool more_than_one  = (layer_code != 0) && (layer_code != 1) && (layer_code != 2) && (layer_code != 4);
       bool more_than_zero = (layer_code != 0);
 
-      if (more_than_zero) {
-        // Insert this pattern
-        auto ins = patt_lifetime_map.insert({patt_ref, 0});
+      PatternLifetime::value_t& lifetime = patt_lifetime.at(izone, izhit, ipatt);  // 0 if the pattern does not exist
 
+      if (more_than_zero) {
         if (!useSecondEarliest_) {
           // Use earliest
-          auto patt_ins = ins.first;  // iterator of patt_lifetime_map pointing to this pattern
-          bool patt_exists = !ins.second;
+          bool patt_exists = (lifetime != 0);
 
           if (patt_exists) {  // if exists
-            if (patt_ins->second == drift_time) {  // is lifetime up?
+            if (lifetime == drift_time) {  // is lifetime up?
               is_lifetime_up = true;
             }
           }
-          patt_ins->second += 1;  // bx starts counting at any hit in the pattern, even single
+          if (lifetime != std::numeric_limits<PatternLifetime::value_t>::max())
+            lifetime += 1;  // bx starts counting at any hit in the pattern, even single
 
         } else {
           // Use 2nd earliest
-          auto patt_ins = ins.first;  // iterator of patt_lifetime_map pointing to this pattern
 
           // The bx_shifter keeps track of a number of booleans from BX 0, 1, ..., drift_time.
-          int bx_shifter = patt_ins->second;
+          int bx_shifter = lifetime;
           int bx2 = bool(bx_shifter & (1<<2));
           int bx1 = bool(bx_shifter & (1<<1));
           int bx0 = bool(bx_shifter & (1<<0));
@@ -420,13 +472,14 @@ void PatternRecognition::process_single_zone(
           bx1 = bx0;
           bx0 = more_than_zero;  // put 1 in shifter when one layer is hit
           bx_shifter = (bx2 << 2) | (bx1 << 1) | bx0;
-          patt_ins->second = bx_shifter;
+          lifetime = bx_shifter;
         }
 
       } else {
         // Zero hit
-        patt_lifetime_map.erase(patt_ref);  // erase if exists
+        lifetime = 0;  // erase if exists
       }
+      is_alive |= (lifetime != 0);
 
       // If lifetime is up, and not single-layer hit patterns (stations 3&4 considered
       // as a single layer), find quality of this pattern
@@ -448,7 +501,7 @@ void PatternRecognition::process_single_zone(
         road.set_endcap     ( (endcap_ == 1) ? 1 : -1 );
         road.set_sector     ( sector_ );
         road.set_sector_idx ( (endcap_ == 1) ? sector_ - 1 : sector_ + 5 );
-        road.set_bx         ( bx_ - drift_time );
+        road.set_bx         ( bx - drift_time );
 
         road.set_zone     ( patt_ref.at(0) );
         road.set_key_zhit ( patt_ref.at(1) );
@@ -467,6 +520,8 @@ void PatternRecognition::process_single_zone(
 
     }  // end loop over patterns
 
+    patt_lifetime.set_alive(izone, izhit, is_alive);
+
     // Output road
     if (max_quality_code != -1) {
       roads.push_back(tmp_road);
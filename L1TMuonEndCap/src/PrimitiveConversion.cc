@@ -9,11 +9,11 @@
 void PrimitiveConversion::configure(
     const GeometryTranslator* tp_geom,
     const SectorProcessorLUT* lut,
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
     const std::vector<int>& zoneBoundaries, int zoneOverlap,
     bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges,
-    bool bugME11Dupes
+    bool bugME11Dupes, bool fillSimCoords
 ) {
   assert(tp_geom != nullptr);
   assert(lut != nullptr);
@@ -24,7 +24,6 @@ void PrimitiveConversion::configure(
   verbose_ = verbose;
   endcap_  = endcap; // 1 for ME+, 2 for ME-
   sector_  = sector;
-  bx_      = bx;
 
   bxShiftCSC_      = bxShiftCSC;
   bxShiftRPC_      = bxShiftRPC;
@@ -37,48 +36,86 @@ void PrimitiveConversion::configure(
   useNewZones_     = useNewZones;
   fixME11Edges_    = fixME11Edges;
   bugME11Dupes_    = bugME11Dupes;
+  fillSimCoords_   = fillSimCoords;
 }
 
 void PrimitiveConversion::process(
-    const std::map<int, TriggerPrimitiveCollection>& selected_prim_map,
+    const PrimitiveLinkTable& selected_prim_map,
     EMTFHitCollection& conv_hits
 ) const {
-  std::map<int, TriggerPrimitiveCollection>::const_iterator map_tp_it  = selected_prim_map.begin();
-  std::map<int, TriggerPrimitiveCollection>::const_iterator map_tp_end = selected_prim_map.end();
+  for (int selected = selected_prim_map.next(0); selected < emtf::NUM_LINKS; selected = selected_prim_map.next(selected+1)) {
+    int pc_segment = 0;  // Counts hits in a single chamber
 
-  for (; map_tp_it != map_tp_end; ++map_tp_it) {
-    // Unique chamber ID in FW, {0, 53} as defined in get_index_csc in src/PrimitiveSelection.cc
-    int selected   = map_tp_it->first;
-    // "Primitive Conversion" sector/station/chamber ID scheme used in FW
-    int pc_sector  = sector_;
-    int pc_station = selected / 9;  // {0, 5} = {ME1 sub 1, ME1 sub 2, ME2, ME3, ME4, neighbor}
-    int pc_chamber = selected % 9;  // Equals CSC ID - 1 for all except neighbor chambers
-    int pc_segment = 0;             // Counts hits in a single chamber
-
-    TriggerPrimitiveCollection::const_iterator tp_it  = map_tp_it->second.begin();
-    TriggerPrimitiveCollection::const_iterator tp_end = map_tp_it->second.end();
+    PrimitiveLinkTable::link_t::const_iterator tp_it  = selected_prim_map.at(selected).begin();
+    PrimitiveLinkTable::link_t::const_iterator tp_end = selected_prim_map.at(selected).end();
 
     for (; tp_it != tp_end; ++tp_it) {
-      EMTFHit conv_hit;
-      if (tp_it->subsystem() == TriggerPrimitive::kCSC) {
-        convert_csc(pc_sector, pc_station, pc_chamber, pc_segment, *tp_it, conv_hit);
-      } else if (tp_it->subsystem() == TriggerPrimitive::kRPC) {
-        convert_rpc(pc_sector, pc_station, pc_chamber, pc_segment, *tp_it, conv_hit);
-      } else if (tp_it->subsystem() == TriggerPrimitive::kGEM) {
-        convert_gem(pc_sector, 0, selected, pc_segment, *tp_it, conv_hit);  // pc_station and pc_chamber are meaningless
-      } else if (tp_it->subsystem() == TriggerPrimitive::kME0) {
-        convert_me0(pc_sector, 0, selected, pc_segment, *tp_it, conv_hit);  // pc_station and pc_chamber are meaningless
-      } else if (tp_it->subsystem() == TriggerPrimitive::kDT) {
-        convert_dt(pc_sector, 0, selected, pc_segment, *tp_it, conv_hit);   // pc_station and pc_chamber are meaningless
-      } else {
-        assert(false && "Incorrect subsystem type");
-      }
-      conv_hits.push_back(conv_hit);
+      conv_hits.push_back(EMTFHit());
+      convert_prim(selected, pc_segment, *tp_it, conv_hits.back());
       pc_segment += 1;
     }
   }
 }
 
+void PrimitiveConversion::process(
+    const PrimitiveLinkTable& inclusive_selected_prim_map,
+    const PrimitiveLinkTable& selected_prim_map,
+    EMTFHitCollection& inclusive_conv_hits,
+    EMTFHitCollection& conv_hits
+) const {
+  for (int selected = inclusive_selected_prim_map.next(0); selected < emtf::NUM_LINKS; selected = inclusive_selected_prim_map.next(selected+1)) {
+    const PrimitiveLinkTable::link_t& inclusive_primitives = inclusive_selected_prim_map.at(selected);
+    const PrimitiveLinkTable::link_t& primitives = selected_prim_map.at(selected);  // empty if not in use
+
+    int pc_segment = 0;            // Counts hits in a single chamber
+    int inclusive_pc_segment = 0;  // Same, for the inclusive hits
+
+    for (const auto& tp : inclusive_primitives) {
+      inclusive_conv_hits.push_back(EMTFHit());
+      convert_prim(selected, inclusive_pc_segment, tp, inclusive_conv_hits.back());
+
+      // Does this primitive survive the truncation?
+      if (pc_segment < (int) primitives.size() && primitives.at(pc_segment) == tp) {
+        if (pc_segment == inclusive_pc_segment) {
+          conv_hits.push_back(inclusive_conv_hits.back());
+        } else {
+          conv_hits.push_back(EMTFHit());
+          convert_prim(selected, pc_segment, tp, conv_hits.back());
+        }
+        pc_segment += 1;
+      }
+      inclusive_pc_segment += 1;
+    }
+    assert(pc_segment == (int) primitives.size());
+  }
+}
+
+void PrimitiveConversion::convert_prim(
+    int selected, int pc_segment,
+    const TriggerPrimitive& muon_primitive,
+    EMTFHit& conv_hit
+) const {
+  // Unique chamber ID in FW, {0, 53} as defined in get_index_csc in src/PrimitiveSelection.cc
+  // "Primitive Conversion" sector/station/chamber ID scheme used in FW
+  int pc_sector  = sector_;
+  int pc_station = selected / 9;  // {0, 5} = {ME1 sub 1, ME1 sub 2, ME2, ME3, ME4, neighbor}
+  int pc_chamber = selected % 9;  // Equals CSC ID - 1 for all except neighbor chambers
+
+  if (muon_primitive.subsystem() == TriggerPrimitive::kCSC) {
+    convert_csc(pc_sector, pc_station, pc_chamber, pc_segment, muon_primitive, conv_hit);
+  } else if (muon_primitive.subsystem() == TriggerPrimitive::kRPC) {
+    convert_rpc(pc_sector, pc_station, pc_chamber, pc_segment, muon_primitive, conv_hit);
+  } else if (muon_primitive.subsystem() == TriggerPrimitive::kGEM) {
+    convert_gem(pc_sector, 0, selected, pc_segment, muon_primitive, conv_hit);  // pc_station and pc_chamber are meaningless
+  } else if (muon_primitive.subsystem() == TriggerPrimitive::kME0) {
+    convert_me0(pc_sector, 0, selected, pc_segment, muon_primitive, conv_hit);  // pc_station and pc_chamber are meaningless
+  } else if (muon_primitive.subsystem() == TriggerPrimitive::kDT) {
+    convert_dt(pc_sector, 0, selected, pc_segment, muon_primitive, conv_hit);   // pc_station and pc_chamber are meaningless
+  } else {
+    assert(false && "Incorrect subsystem type");
+  }
+}
+
 
 // _____________________________________________________________________________
 // CSC functions
@@ -160,7 +197,7 @@ void PrimitiveConversion::convert_csc(
   convert_csc_details(conv_hit);
 
   // Add coordinates from fullsim
-  {
+  if (fillSimCoords_) {
     const GlobalPoint& gp = tp_geom_->getGlobalPoint(muon_primitive);
     double glob_phi   = emtf::rad_to_deg(gp.phi().value());
     double glob_theta = emtf::rad_to_deg(gp.theta());
@@ -555,8 +592,9 @@ void PrimitiveConversion::convert_rpc(
   conv_hit.set_neighbor      ( is_neighbor );
   conv_hit.set_sector_idx    ( (endcap_ == 1) ? sector_ - 1 : sector_ + 5 );
 
-  // Get coordinates from fullsim
-  bool use_fullsim_coords = true;
+  // Get coordinates from fullsim. If phi and theta are recalculated using the
+  // CPPF LUTs, they are only used for the *_sim coordinates.
+  bool use_fullsim_coords = fillSimCoords_ || !use_cppf_lut(tp_data.isCPPF);
 
   if (tp_data.isCPPF) {  // CPPF digis from EMTF unpacker or CPPF emulator
     conv_hit.set_phi_fp   ( tp_data.phi_int * 4 );   // Full-precision integer phi
@@ -622,6 +660,16 @@ void PrimitiveConversion::convert_rpc(
   convert_rpc_details(conv_hit, tp_data.isCPPF);
 }
 
+bool PrimitiveConversion::use_cppf_lut(bool isCPPF) const {
+  // Do coordinate conversion using the CPPF LUTs. Not needed if the received digis are CPPF digis.
+  bool use_cppf_lut = !isCPPF;
+#ifdef PHASE_TWO_TRIGGER
+  // The CPPF LUTs fail for Phase 2 geometry
+  use_cppf_lut = false;
+#endif
+  return use_cppf_lut;
+}
+
 void PrimitiveConversion::convert_rpc_details(EMTFHit& conv_hit, bool isCPPF) const {
   const bool is_neighbor = conv_hit.Neighbor();
 
@@ -637,14 +685,7 @@ void PrimitiveConversion::convert_rpc_details(EMTFHit& conv_hit, bool isCPPF) co
   int fph = conv_hit.Phi_fp();
   int th  = conv_hit.Theta_fp();
 
-  // Do coordinate conversion using the CPPF LUTs. Not needed if the received digis are CPPF digis.
-  bool use_cppf_lut = !isCPPF;
-#ifdef PHASE_TWO_TRIGGER
-  // The CPPF LUTs fail for Phase 2 geometry
-  use_cppf_lut = false;
-#endif
-
-  if (use_cppf_lut) {
+  if (use_cppf_lut(isCPPF)) {
     int halfstrip = (conv_hit.Strip_low() + conv_hit.Strip_hi() - 1);
     assert(1 <= halfstrip && halfstrip <= 64);
 
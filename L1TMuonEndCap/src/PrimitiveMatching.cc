@@ -10,14 +10,13 @@ namespace {
 
 
 void PrimitiveMatching::configure(
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     bool fixZonePhi, bool useNewZones,
     bool bugSt2PhDiff, bool bugME11Dupes
 ) {
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   fixZonePhi_      = fixZonePhi;
   useNewZones_     = useNewZones;
@@ -26,28 +25,12 @@ void PrimitiveMatching::configure(
 }
 
 void PrimitiveMatching::process(
-    const std::deque<EMTFHitCollection>& extended_conv_hits,
+    int bx,
+    const ConvHitStore& conv_hit_store,
     const emtf::zone_array<EMTFRoadCollection>& zone_roads,
     emtf::zone_array<EMTFTrackCollection>& zone_tracks
 ) const {
 
-  // Function to update fs_history encoded in fs_segment
-  auto update_fs_history = [](int fs_segment, int this_bx, int hit_bx) {
-    // 0 for current BX, 1 for previous BX, 2 for BX before that
-    int fs_history = this_bx - hit_bx;
-    fs_segment |= ((fs_history & 0x3)<<4);
-    return fs_segment;
-  };
-
-  // Function to update bt_history encoded in bt_segment
-  auto update_bt_history = [](int bt_segment, int this_bx, int hit_bx) {
-    // 0 for current BX, 1 for previous BX, 2 for BX before that
-    int bt_history = this_bx - hit_bx;
-    bt_segment |= ((bt_history & 0x3)<<5);
-    return bt_segment;
-  };
-
-
   // Exit if no roads
   int num_roads = 0;
   for (const auto& roads : zone_roads)
@@ -69,54 +52,18 @@ void PrimitiveMatching::process(
     }
   }
 
-  // Organize converted hits by (zone, station)
-  std::array<EMTFHitCollection, emtf::NUM_ZONES*emtf::NUM_STATIONS> zs_conv_hits;
-
-  bool use_fs_zone_code = true;  // use zone code as in firmware find_segment module
-
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_it  = extended_conv_hits.begin();
-  std::deque<EMTFHitCollection>::const_iterator ext_conv_hits_end = extended_conv_hits.end();
-
-  for (; ext_conv_hits_it != ext_conv_hits_end; ++ext_conv_hits_it) {
-    EMTFHitCollection::const_iterator conv_hits_it  = ext_conv_hits_it->begin();
-    EMTFHitCollection::const_iterator conv_hits_end = ext_conv_hits_it->end();
-
-    for (; conv_hits_it != conv_hits_end; ++conv_hits_it) {
-      int istation = conv_hits_it->Station()-1;
-      int zone_code = conv_hits_it->Zone_code();  // decide based on original zone code
-      if (use_fs_zone_code)
-        zone_code = conv_hits_it->FS_zone_code();  // decide based on new zone code
-
-      // A hit can go into multiple zones
-      for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
-        if (!zone_roads.at(izone).empty()) {
-
-          if (zone_code & (1<<izone)) {
-            const int zs = (izone*emtf::NUM_STATIONS) + istation;
-            zs_conv_hits.at(zs).push_back(*conv_hits_it);
-
-            // Update fs_history and bt_history depending on the processor BX
-            // This update only goes into the hits associated to a track, it does not affect the original hit collection
-            EMTFHit& conv_hit = zs_conv_hits.at(zs).back();   // pass by reference
-            int old_fs_segment = conv_hit.FS_segment();
-            int new_fs_segment = update_fs_history(old_fs_segment, bx_, conv_hit.BX());
-            conv_hit.set_fs_segment( new_fs_segment );
-
-            int old_bt_segment = conv_hit.BT_segment();
-            int new_bt_segment = update_bt_history(old_bt_segment, bx_, conv_hit.BX());
-            conv_hit.set_bt_segment( new_bt_segment );
-          }
-        }
-      }
-
-    }  // end loop over conv_hits
-  }  // end loop over extended_conv_hits
+  // The converted hits are organized by (zone, station) in conv_hit_store,
+  // with fs_history and bt_history updated depending on the processor BX
 
   if (verbose_ > 1) {  // debug
     for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
+      if (zone_roads.at(izone).empty())
+        continue;
+
       for (int istation = 0; istation < emtf::NUM_STATIONS; ++istation) {
-        const int zs = (izone*emtf::NUM_STATIONS) + istation;
-        for (const auto& conv_hit : zs_conv_hits.at(zs)) {
+        const ConvHitStore::ZoneStationHits& conv_hits = conv_hit_store.zone_station_hits(izone, istation);
+        for (int ihit = 0; ihit < conv_hits.size(); ++ihit) {
+          const EMTFHit& conv_hit = *conv_hits.hit[ihit];
           std::cout << "z: " << izone << " st: " << istation+1 << " cscid: " << conv_hit.CSC_ID()
               << " ph_zone_phi: " << conv_hit.Zone_hit() << " ph_low_prec: " << (conv_hit.Zone_hit()<<5)
               << " ph_high_prec: " << conv_hit.Phi_fp() << " ph_high_low_diff: " << (conv_hit.Phi_fp() - (conv_hit.Zone_hit()<<5))
@@ -135,13 +82,13 @@ void PrimitiveMatching::process(
     for (int istation = 0; istation < emtf::NUM_STATIONS; ++istation) {
       const int zs = (izone*emtf::NUM_STATIONS) + istation;
 
-      // This leaves zone_roads.at(izone) and zs_conv_hits.at(zs) unchanged
+      // This leaves zone_roads.at(izone) and the hits in conv_hit_store unchanged
       // zs_phi_differences.at(zs) gets filled with a pair of <phi_diff, conv_hit> for the
       // conv_hit with the lowest phi_diff from the pattern in this station and zone
       process_single_zone_station(
           izone+1, istation+1,
           zone_roads.at(izone),
-          zs_conv_hits.at(zs),
+          conv_hit_store.zone_station_hits(izone, istation),
           zs_phi_differences.at(zs)
       );
 
@@ -191,7 +138,7 @@ void PrimitiveMatching::process(
       for (int istation = 0; istation < emtf::NUM_STATIONS; ++istation) {
         const int zs = (izone*emtf::NUM_STATIONS) + istation;
 
-        const EMTFHitCollection& conv_hits = zs_conv_hits.at(zs);
+        const ConvHitStore::ZoneStationHits& conv_hits = conv_hit_store.zone_station_hits(izone, istation);
         int       ph_diff      = zs_phi_differences.at(zs).at(iroad).first;
         hit_ptr_t conv_hit_ptr = zs_phi_differences.at(zs).at(iroad).second;
 
@@ -231,7 +178,7 @@ void PrimitiveMatching::process(
 void PrimitiveMatching::process_single_zone_station(
     int zone, int station,
     const EMTFRoadCollection& roads,
-    const EMTFHitCollection& conv_hits,
+    const ConvHitStore::ZoneStationHits& conv_hits,
     std::vector<hit_sort_pair_t>& phi_differences
 ) const {
   // max phi difference between pattern and segment
@@ -300,6 +247,11 @@ void PrimitiveMatching::process_single_zone_station(
   // ___________________________________________________________________________
   // For each road, find the segment with min phi difference in every station
 
+  const int num_conv_hits = conv_hits.size();
+
+  // Phi difference to the road for every hit, invalid if too high
+  std::vector<int> ph_diffs(num_conv_hits, invalid_ph_diff);
+
   EMTFRoadCollection::const_iterator roads_it  = roads.begin();
   EMTFRoadCollection::const_iterator roads_end = roads.end();
 
@@ -312,33 +264,25 @@ void PrimitiveMatching::process_single_zone_station(
       ph_pat <<= 5;  // add missing 5 lower bits to pattern phi
     }
 
-    std::vector<hit_sort_pair_t> tmp_phi_differences;
-
-    EMTFHitCollection::const_iterator conv_hits_it  = conv_hits.begin();
-    EMTFHitCollection::const_iterator conv_hits_end = conv_hits.end();
-
-    for (; conv_hits_it != conv_hits_end; ++conv_hits_it) {
-      int ph_seg     = conv_hits_it->Phi_fp();  // ph from segments
-      int ph_seg_red = ph_seg >> (bw_fph-bpow-1);  // remove unused low bits
-      assert(ph_seg >= 0);
+    // No branch in this loop, so that it is vectorized by the compiler
+    const int ph_seg_shift = fixZonePhi_ ? 0 : (bw_fph-bpow-1);  // use full-precision phi, or remove unused low bits
+    const int* ph_segs = conv_hits.phi_fp.data();  // ph from segments
+    int num_valid_ph_diffs = 0;
 
-      if (fixZonePhi_) {
-        ph_seg_red = ph_seg;  // use full-precision phi
-      }
+    for (int ihit = 0; ihit < num_conv_hits; ++ihit) {
+      int ph_seg_red = ph_segs[ihit] >> ph_seg_shift;
 
       // Get abs phi difference
       int ph_diff = abs_diff(ph_pat, ph_seg_red);
-      if (ph_diff > max_ph_diff)
-        ph_diff = invalid_ph_diff;  // difference is too high, cannot be the same pattern
-
-      if (ph_diff != invalid_ph_diff)
-        tmp_phi_differences.push_back(std::make_pair(ph_diff, conv_hits_it));  // make a key-value pair
+      bool is_valid = (ph_diff <= max_ph_diff);  // else difference is too high, cannot be the same pattern
+      ph_diffs[ihit] = is_valid ? ph_diff : invalid_ph_diff;
+      num_valid_ph_diffs += is_valid;
     }
 
     // _________________________________________________________________________
     // Sort to find the segment with min phi difference
 
-    if (!tmp_phi_differences.empty()) {
+    if (num_valid_ph_diffs != 0) {
       // Because the sorting is sensitive to FW ordering, use the exact FW sorting.
       // This implementation still slightly differs from FW because I prefer to
       // use a sorting function that is as generic as possible.
@@ -354,63 +298,61 @@ void PrimitiveMatching::process_single_zone_station(
         const int seg_ch    = 2;
         const int tot_diff  = (max_drift*zone_cham*seg_ch) + ((zone_cham == 4) ? 3 : 12);  // provide padding for 3-input comparators
 
-        std::vector<hit_sort_pair_t> fw_sort_array(tot_diff, std::make_pair(invalid_ph_diff, conv_hits_end));
+        std::array<hit_sort_pair_t, (3*7*2) + 12> fw_sort_array;  // large enough for any tot_diff
+        assert(tot_diff <= (int) fw_sort_array.size());
+        std::fill(fw_sort_array.begin(), fw_sort_array.begin() + tot_diff, std::make_pair(invalid_ph_diff, -1));
 
         // FW doesn't check if the hit is CSC or RPC
-        std::vector<hit_sort_pair_t>::const_iterator phdiffs_it  = tmp_phi_differences.begin();
-        std::vector<hit_sort_pair_t>::const_iterator phdiffs_end = tmp_phi_differences.end();
+        for (int ihit = 0; ihit < num_conv_hits; ++ihit) {
+          int ph_diff    = ph_diffs[ihit];
+          if (ph_diff == invalid_ph_diff)
+            continue;
 
-        for (; phdiffs_it != phdiffs_end; ++phdiffs_it) {
-          //int ph_diff    = phdiffs_it->first;
-          int fs_segment = phdiffs_it->second->FS_segment();
+          int fs_segment = conv_hits.fs_segment[ihit];
 
           // Calculate the index to put into the fw_sort_array
           int fs_history = ((fs_segment>>4) & 0x3);
           int fs_chamber = ((fs_segment>>1) & 0x7);
           fs_segment = (fs_segment & 0x1);
-          unsigned fw_sort_array_index = (fs_history * zone_cham * seg_ch) + (fs_chamber * seg_ch) + fs_segment;
+          int fw_sort_array_index = (fs_history * zone_cham * seg_ch) + (fs_chamber * seg_ch) + fs_segment;
 
           assert(fs_history < max_drift && fs_chamber < zone_cham && fs_segment < seg_ch);
-          assert(fw_sort_array_index < fw_sort_array.size());
-          fw_sort_array.at(fw_sort_array_index) = *phdiffs_it;
+          assert(fw_sort_array_index < tot_diff);
+          fw_sort_array[fw_sort_array_index] = std::make_pair(ph_diff, ihit);  // make a key-value pair
         }
 
         // Debug
         //std::cout << "phdiffs" << std::endl;
-        //for (unsigned i = 0; i < fw_sort_array.size(); ++i)
+        //for (int i = 0; i < tot_diff; ++i)
         //  std::cout << fw_sort_array.at(i).first << " ";
         //std::cout << std::endl;
 
-        // Debug
-        //std::cout << "Before sort" << std::endl;
-        //for (unsigned i = 0; i < fw_sort_array.size(); ++i)
-        //  std::cout << fw_sort_array.at(i).second->FS_segment() << " ";
-        //std::cout << std::endl;
-
         // Find the best phi difference according to FW sorting
-        //merge_sort3(fw_sort_array.begin(), fw_sort_array.end(), less_ph_diff_cmp, less_ph_diff_cmp3);
-        merge_sort3_with_hint(fw_sort_array.begin(), fw_sort_array.end(), less_ph_diff_cmp, less_ph_diff_cmp3, ((tot_diff == 54) ? tot_diff/2 : tot_diff/3));
+        // Only the front of the sorted array is needed, it is found with the same comparisons
+        // as merge_sort3_with_hint(), without sorting the rest
+        //merge_sort3_with_hint(fw_sort_array.begin(), fw_sort_array.begin() + tot_diff, less_ph_diff_cmp, less_ph_diff_cmp3, ((tot_diff == 54) ? tot_diff/2 : tot_diff/3));
+        auto best_it = merge_sort3_front_with_hint(fw_sort_array.begin(), fw_sort_array.begin() + tot_diff, less_ph_diff_cmp, less_ph_diff_cmp3, ((tot_diff == 54) ? tot_diff/2 : tot_diff/3));
 
         // Store the best phi difference
-        phi_differences.push_back(fw_sort_array.front());
-
-        // Debug
-        //std::cout << "After sort" << std::endl;
-        //for (unsigned i = 0; i < fw_sort_array.size(); ++i)
-        //  std::cout << fw_sort_array.at(i).second->FS_segment() << " ";
-        //std::cout << std::endl;
+        phi_differences.push_back(*best_it);
 
       } else {  // use C++ sorting
-        struct {
-          typedef hit_sort_pair_t value_type;
-          bool operator()(const value_type& lhs, const value_type& rhs) const {
-            // If different types, prefer CSC over RPC; else prefer the closer hit in dPhi
-            if (lhs.second->Subsystem() != rhs.second->Subsystem())
-              return (lhs.second->Subsystem() == TriggerPrimitive::kCSC);
-            else
-              return lhs.first <= rhs.first;
-          }
-        } tmp_less_ph_diff_cmp;
+        std::vector<hit_sort_pair_t> tmp_phi_differences;
+
+        for (int ihit = 0; ihit < num_conv_hits; ++ihit) {
+          if (ph_diffs[ihit] != invalid_ph_diff)
+            tmp_phi_differences.push_back(std::make_pair(ph_diffs[ihit], ihit));  // make a key-value pair
+        }
+
+        auto tmp_less_ph_diff_cmp = [&conv_hits](const hit_sort_pair_t& lhs, const hit_sort_pair_t& rhs) {
+          // If different types, prefer CSC over RPC; else prefer the closer hit in dPhi
+          const int lhs_subsystem = conv_hits.subsystem[lhs.second];
+          const int rhs_subsystem = conv_hits.subsystem[rhs.second];
+          if (lhs_subsystem != rhs_subsystem)
+            return (lhs_subsystem == TriggerPrimitive::kCSC);
+          else
+            return lhs.first <= rhs.first;
+        };
 
         // Find best phi difference
         std::stable_sort(tmp_phi_differences.begin(), tmp_phi_differences.end(), tmp_less_ph_diff_cmp);
@@ -421,26 +363,25 @@ void PrimitiveMatching::process_single_zone_station(
 
     } else {
       // No segment found
-      phi_differences.push_back(std::make_pair(invalid_ph_diff, conv_hits_end));  // make a key-value pair
+      phi_differences.push_back(std::make_pair(invalid_ph_diff, -1));  // make a key-value pair
     }
 
   }  // end loop over roads
 }
 
 void PrimitiveMatching::insert_hits(
-    hit_ptr_t conv_hit_ptr, const EMTFHitCollection& conv_hits,
+    hit_ptr_t conv_hit_ptr, const ConvHitStore::ZoneStationHits& conv_hits,
     EMTFTrack& track
 ) const {
-  EMTFHitCollection::const_iterator conv_hits_it  = conv_hits.begin();
-  EMTFHitCollection::const_iterator conv_hits_end = conv_hits.end();
+  const EMTFHit& conv_hit_j = *conv_hits.hit.at(conv_hit_ptr);
 
-  const bool is_csc_me11 = (conv_hit_ptr->Subsystem() == TriggerPrimitive::kCSC) &&
-      (conv_hit_ptr->Station() == 1) && (conv_hit_ptr->Ring() == 1 || conv_hit_ptr->Ring() == 4);
+  const bool is_csc_me11 = (conv_hit_j.Subsystem() == TriggerPrimitive::kCSC) &&
+      (conv_hit_j.Station() == 1) && (conv_hit_j.Ring() == 1 || conv_hit_j.Ring() == 4);
 
   // Find all possible duplicated hits, insert them
-  for (; conv_hits_it != conv_hits_end; ++conv_hits_it) {
-    const EMTFHit& conv_hit_i = *conv_hits_it;
-    const EMTFHit& conv_hit_j = *conv_hit_ptr;
+  // The hits are only copied here, with fs_history and bt_history for this BX
+  for (int ihit = 0; ihit < conv_hits.size(); ++ihit) {
+    const EMTFHit& conv_hit_i = *conv_hits.hit[ihit];
 
     // All these must match: [bx_history][station][chamber][segment]
     if (
@@ -468,7 +409,7 @@ void PrimitiveMatching::insert_hits(
       assert(conv_hit_i.Phi_fp() == conv_hit_j.Phi_fp());
 #endif
 
-      track.push_Hit( conv_hit_i );
+      track.push_Hit( conv_hits.materialize(ihit) );
 
     } else if (
       (bugME11Dupes_ && is_csc_me11) &&  // if reproduce ME1/1 theta duplication bug, do not check 'ring', 'strip' and 'pattern'
@@ -491,7 +432,7 @@ void PrimitiveMatching::insert_hits(
       //track.push_Hit( conv_hit_i );
 
       // Dirty hack
-      EMTFHit tmp_hit = conv_hit_j;
+      EMTFHit tmp_hit = conv_hits.materialize(conv_hit_ptr);
       tmp_hit.set_theta_fp( conv_hit_i.Theta_fp() );
       track.push_Hit( tmp_hit );
     }
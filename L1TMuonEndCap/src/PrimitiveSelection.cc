@@ -3,7 +3,7 @@
 #include "L1Trigger/L1TMuonEndCap/interface/TrackTools.h"
 
 
-#include "helper.h"  // merge_map_into_map, assert_no_abort
+#include "helper.h"
 
 #define NUM_CSC_CHAMBERS 6*9   // 18 in ME1; 9x3 in ME2,3,4; 9 from neighbor sector.
                                // Arranged in FW as 6 stations, 9 chambers per station.
@@ -16,7 +16,7 @@
 
 
 void PrimitiveSelection::configure(
-      int verbose, int endcap, int sector, int bx,
+      int verbose, int endcap, int sector,
       int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
       bool includeNeighbor, bool duplicateTheta,
       bool bugME11Dupes
@@ -24,7 +24,6 @@ void PrimitiveSelection::configure(
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   bxShiftCSC_      = bxShiftCSC;
   bxShiftRPC_      = bxShiftRPC;
@@ -41,22 +40,31 @@ void PrimitiveSelection::configure(
 template<>
 void PrimitiveSelection::process(
     CSCTag tag,
+    int bx,
     const TriggerPrimitiveCollection& muon_primitives,
-    std::map<int, TriggerPrimitiveCollection>& selected_csc_map
+    const EMTFPrimitiveIndex& prim_index,
+    PrimitiveLinkTable& selected_csc_map
 ) const {
-  TriggerPrimitiveCollection::const_iterator tp_it  = muon_primitives.begin();
-  TriggerPrimitiveCollection::const_iterator tp_end = muon_primitives.end();
+  const EMTFPrimitiveIndex::index_list_t& candidates = prim_index.get(TriggerPrimitive::kCSC, endcap_, sector_, bx);
 
-  for (; tp_it != tp_end; ++tp_it) {
-    TriggerPrimitive new_tp = *tp_it;  // make a copy and apply patches to this copy
+  for (unsigned i : candidates) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+
+    // Patches are applied to a copy, which is only made if a patch is needed
+    TriggerPrimitive patched_tp;
+    const TriggerPrimitive* new_tp = &tp;
 
     // Patch the CLCT pattern number
     // It should be 0-10, see: L1Trigger/CSCTriggerPrimitives/src/CSCMotherboard.cc
     bool patchPattern = true;
-    if (patchPattern && new_tp.subsystem() == TriggerPrimitive::kCSC) {
-      if (new_tp.getCSCData().pattern == 11 || new_tp.getCSCData().pattern == 12 || new_tp.getCSCData().pattern == 13 || new_tp.getCSCData().pattern == 14) {  // 11, 12, 13, 14 -> 10
-        edm::LogWarning("L1T") << "EMTF patching corrupt CSC LCT pattern: changing " << new_tp.getCSCData().pattern << " to 10 (station " << new_tp.detId<CSCDetId>().station() << " ring " << new_tp.detId<CSCDetId>().ring() << ")";
-        new_tp.accessCSCData().pattern = 10;
+    if (patchPattern && new_tp->subsystem() == TriggerPrimitive::kCSC) {
+      if (new_tp->getCSCData().pattern == 11 || new_tp->getCSCData().pattern == 12 || new_tp->getCSCData().pattern == 13 || new_tp->getCSCData().pattern == 14) {  // 11, 12, 13, 14 -> 10
+        edm::LogWarning("L1T") << "EMTF patching corrupt CSC LCT pattern: changing " << new_tp->getCSCData().pattern << " to 10 (station " << new_tp->detId<CSCDetId>().station() << " ring " << new_tp->detId<CSCDetId>().ring() << ")";
+        if (new_tp != &patched_tp) {
+          patched_tp = tp;
+          new_tp = &patched_tp;
+        }
+        patched_tp.accessCSCData().pattern = 10;
       }
     }
 
@@ -67,27 +75,31 @@ void PrimitiveSelection::process(
     // Quality was hacked to store the number of hits
     patchQuality = false;
 #endif
-    if (patchQuality && new_tp.subsystem() == TriggerPrimitive::kCSC) {
-      if (new_tp.getCSCData().quality == 0) {  // 0 -> 1
-        edm::LogWarning("L1T") << "EMTF patching corrupt CSC LCT quality: changing " << new_tp.getCSCData().quality << " to 1 (station " << new_tp.detId<CSCDetId>().station() << " ring " << new_tp.detId<CSCDetId>().ring() << ")";
-        new_tp.accessCSCData().quality = 1;
+    if (patchQuality && new_tp->subsystem() == TriggerPrimitive::kCSC) {
+      if (new_tp->getCSCData().quality == 0) {  // 0 -> 1
+        edm::LogWarning("L1T") << "EMTF patching corrupt CSC LCT quality: changing " << new_tp->getCSCData().quality << " to 1 (station " << new_tp->detId<CSCDetId>().station() << " ring " << new_tp->detId<CSCDetId>().ring() << ")";
+        if (new_tp != &patched_tp) {
+          patched_tp = tp;
+          new_tp = &patched_tp;
+        }
+        patched_tp.accessCSCData().quality = 1;
       }
     }
 
-    int selected_csc = select_csc(new_tp); // Returns CSC "link" index (0 - 53)
+    int selected_csc = select_csc(*new_tp, bx); // Returns CSC "link" index (0 - 53)
 
     if (selected_csc >= 0) {
       assert(selected_csc < NUM_CSC_CHAMBERS);
 
       //FIXME
       if (selected_csc_map[selected_csc].size() < 2) {
-        selected_csc_map[selected_csc].push_back(new_tp);
+        selected_csc_map[selected_csc].push_back(*new_tp);
       }
       else {
         edm::LogWarning("L1T") << "\n******************* EMTF EMULATOR: SUPER-BIZZARE CASE *******************";
         edm::LogWarning("L1T") << "Found 3 CSC trigger primitives in the same chamber";
         for (int ii = 0; ii < 3; ii++) {
-          TriggerPrimitive tp_err = (ii < 2 ? selected_csc_map[selected_csc].at(ii) : new_tp);
+          const TriggerPrimitive& tp_err = (ii < 2 ? selected_csc_map[selected_csc].at(ii) : *new_tp);
           edm::LogWarning("L1T") << "LCT #" << ii+1 << ": BX " << tp_err.getBX()
                     << ", endcap " << tp_err.detId<CSCDetId>().endcap() << ", sector " << tp_err.detId<CSCDetId>().triggerSector()
                     << ", station " << tp_err.detId<CSCDetId>().station() << ", ring " << tp_err.detId<CSCDetId>().ring()
@@ -98,18 +110,14 @@ void PrimitiveSelection::process(
       }
 
     } // End conditional: if (selected_csc >= 0)
-  } // End loop: for (; tp_it != tp_end; ++tp_it)
+  } // End loop: for (unsigned i : candidates)
 
   // Duplicate CSC muon primitives
   // If there are 2 LCTs in the same chamber with (strip, wire) = (s1, w1) and (s2, w2)
   // make all combinations with (s1, w1), (s2, w1), (s1, w2), (s2, w2)
   if (duplicateTheta_) {
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_csc_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_csc_map.end();
-
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int selected = selected_csc_map.next(0); selected < emtf::NUM_LINKS; selected = selected_csc_map.next(selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_csc_map[selected];  // pass by reference
 
       if (tmp_primitives.size() >= 4) {
         const TriggerPrimitive& tmp_tp = tmp_primitives.front();
@@ -169,18 +177,20 @@ void PrimitiveSelection::process(
 template<>
 void PrimitiveSelection::process(
     RPCTag tag,
+    int bx,
     const TriggerPrimitiveCollection& muon_primitives,
-    std::map<int, TriggerPrimitiveCollection>& selected_rpc_map
+    const EMTFPrimitiveIndex& prim_index,
+    PrimitiveLinkTable& selected_rpc_map
 ) const {
-  TriggerPrimitiveCollection::const_iterator tp_it  = muon_primitives.begin();
-  TriggerPrimitiveCollection::const_iterator tp_end = muon_primitives.end();
+  const EMTFPrimitiveIndex::index_list_t& candidates = prim_index.get(TriggerPrimitive::kRPC, endcap_, sector_, bx);
 
-  for (; tp_it != tp_end; ++tp_it) {
-    int selected_rpc = select_rpc(*tp_it);  // Returns RPC "link" index
+  for (unsigned i : candidates) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+    int selected_rpc = select_rpc(tp, bx);  // Returns RPC "link" index
 
     if (selected_rpc >= 0) {
       assert(selected_rpc < NUM_RPC_CHAMBERS);
-      selected_rpc_map[selected_rpc].push_back(*tp_it);
+      selected_rpc_map[selected_rpc].push_back(tp);
     }
   }
 
@@ -214,12 +224,8 @@ void PrimitiveSelection::process(
       }
     } cluster_size_cut;
 
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_rpc_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_rpc_map.end();
-
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int selected = selected_rpc_map.next(0); selected < emtf::NUM_LINKS; selected = selected_rpc_map.next(selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_rpc_map[selected];  // pass by reference
 
       //FIXME
       // Check to see if unpacked CPPF digis have <= 2 digis per chamber, as expected
@@ -252,17 +258,14 @@ void PrimitiveSelection::process(
   // Note: RE3/2 & RE3/3 are considered as one chamber; RE4/2 & RE4/3 too.
   bool map_rpc_to_csc = true;
   if (map_rpc_to_csc) {
-    std::map<int, TriggerPrimitiveCollection> tmp_selected_rpc_map;
-
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_rpc_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_rpc_map.end();
+    PrimitiveLinkTable& tmp_selected_rpc_map = tmp_selected_rpc_map_;
+    tmp_selected_rpc_map.clear();
 
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int rpc_selected = selected_rpc_map.next(0); rpc_selected < emtf::NUM_LINKS; rpc_selected = selected_rpc_map.next(rpc_selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_rpc_map[rpc_selected];  // pass by reference
 
-      int rpc_sub = selected / 10;
-      int rpc_chm = selected % 10;
+      int rpc_sub = rpc_selected / 10;
+      int rpc_chm = rpc_selected % 10;
 
       int pc_station = -1;
       int pc_chamber = -1;
@@ -323,13 +326,13 @@ void PrimitiveSelection::process(
       assert(pc_station != -1 && pc_chamber != -1);
       assert(pc_station < 6 && pc_chamber < 9);
 
-      selected = (pc_station * 9) + pc_chamber;
+      int selected = (pc_station * 9) + pc_chamber;
 
       bool ignore_this_rpc_chm = false;
       if (rpc_chm == 3 || rpc_chm == 5) { // special case of RE3,4/2 and RE3,4/3 chambers
         // if RE3,4/2 exists, ignore RE3,4/3. In C++, this assumes that the loop
         // over selected_rpc_map will always find RE3,4/2 before RE3,4/3
-        if (tmp_selected_rpc_map.find(selected) != tmp_selected_rpc_map.end())
+        if (tmp_selected_rpc_map.has(selected))
           ignore_this_rpc_chm = true;
       }
 
@@ -349,14 +352,11 @@ void PrimitiveSelection::process(
       }
 
       // Keep the stubs in the temporary map
-      if (tmp_selected_rpc_map.find(selected) == tmp_selected_rpc_map.end()) {
-        tmp_selected_rpc_map[selected] = tmp_primitives;
-      } else {
-        tmp_selected_rpc_map[selected].insert(tmp_selected_rpc_map[selected].end(), tmp_primitives.begin(), tmp_primitives.end());
-      }
+      PrimitiveLinkTable::link_t& tmp_rpc_primitives = tmp_selected_rpc_map[selected];
+      tmp_rpc_primitives.insert(tmp_rpc_primitives.end(), tmp_primitives.begin(), tmp_primitives.end());
     }  // end loop over selected_rpc_map
 
-    std::swap(selected_rpc_map, tmp_selected_rpc_map);  // replace the original map
+    selected_rpc_map.take(tmp_selected_rpc_map);  // replace the original map
   }  // end if map_rpc_to_csc
 }
 
@@ -366,18 +366,20 @@ void PrimitiveSelection::process(
 template<>
 void PrimitiveSelection::process(
     GEMTag tag,
+    int bx,
     const TriggerPrimitiveCollection& muon_primitives,
-    std::map<int, TriggerPrimitiveCollection>& selected_gem_map
+    const EMTFPrimitiveIndex& prim_index,
+    PrimitiveLinkTable& selected_gem_map
 ) const {
-  TriggerPrimitiveCollection::const_iterator tp_it  = muon_primitives.begin();
-  TriggerPrimitiveCollection::const_iterator tp_end = muon_primitives.end();
+  const EMTFPrimitiveIndex::index_list_t& candidates = prim_index.get(TriggerPrimitive::kGEM, endcap_, sector_, bx);
 
-  for (; tp_it != tp_end; ++tp_it) {
-    int selected_gem = select_gem(*tp_it);  // Returns GEM "link" index
+  for (unsigned i : candidates) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+    int selected_gem = select_gem(tp, bx);  // Returns GEM "link" index
 
     if (selected_gem >= 0) {
       assert(selected_gem < NUM_GEM_CHAMBERS);
-      selected_gem_map[selected_gem].push_back(*tp_it);
+      selected_gem_map[selected_gem].push_back(tp);
     }
   }
 
@@ -392,12 +394,8 @@ void PrimitiveSelection::process(
       }
     } cluster_size_cut;
 
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_gem_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_gem_map.end();
-
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      //int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int selected = selected_gem_map.next(0); selected < emtf::NUM_LINKS; selected = selected_gem_map.next(selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_gem_map[selected];  // pass by reference
 
       // Apply cluster size cut
       tmp_primitives.erase(
@@ -418,30 +416,28 @@ void PrimitiveSelection::process(
 template<>
 void PrimitiveSelection::process(
     ME0Tag tag,
+    int bx,
     const TriggerPrimitiveCollection& muon_primitives,
-    std::map<int, TriggerPrimitiveCollection>& selected_me0_map
+    const EMTFPrimitiveIndex& prim_index,
+    PrimitiveLinkTable& selected_me0_map
 ) const {
-  TriggerPrimitiveCollection::const_iterator tp_it  = muon_primitives.begin();
-  TriggerPrimitiveCollection::const_iterator tp_end = muon_primitives.end();
+  const EMTFPrimitiveIndex::index_list_t& candidates = prim_index.get(TriggerPrimitive::kME0, endcap_, sector_, bx);
 
-  for (; tp_it != tp_end; ++tp_it) {
-    int selected_me0 = select_me0(*tp_it);  // Returns ME0 "link" index
+  for (unsigned i : candidates) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+    int selected_me0 = select_me0(tp, bx);  // Returns ME0 "link" index
 
     if (selected_me0 >= 0) {
       assert(selected_me0 < NUM_GEM_CHAMBERS);
-      selected_me0_map[selected_me0].push_back(*tp_it);
+      selected_me0_map[selected_me0].push_back(tp);
     }
   }
 
   // Apply truncation
   bool apply_truncation = true;
   if (apply_truncation) {
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_me0_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_me0_map.end();
-
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      //int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int selected = selected_me0_map.next(0); selected < emtf::NUM_LINKS; selected = selected_me0_map.next(selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_me0_map[selected];  // pass by reference
 
       // Keep the first 20 clusters
       if (tmp_primitives.size() > 20)
@@ -456,29 +452,27 @@ void PrimitiveSelection::process(
 template<>
 void PrimitiveSelection::process(
     DTTag tag,
+    int bx,
     const TriggerPrimitiveCollection& muon_primitives,
-    std::map<int, TriggerPrimitiveCollection>& selected_dt_map
+    const EMTFPrimitiveIndex& prim_index,
+    PrimitiveLinkTable& selected_dt_map
 ) const {
-  TriggerPrimitiveCollection::const_iterator tp_it  = muon_primitives.begin();
-  TriggerPrimitiveCollection::const_iterator tp_end = muon_primitives.end();
+  const EMTFPrimitiveIndex::index_list_t& candidates = prim_index.get(TriggerPrimitive::kDT, endcap_, sector_, bx);
 
-  for (; tp_it != tp_end; ++tp_it) {
-    int selected_dt = select_dt(*tp_it);  // Returns DT "link" index
+  for (unsigned i : candidates) {
+    const TriggerPrimitive& tp = muon_primitives.at(i);
+    int selected_dt = select_dt(tp, bx);  // Returns DT "link" index
 
     if (selected_dt >= 0) {
       assert(selected_dt < NUM_DT_CHAMBERS);
-      selected_dt_map[selected_dt].push_back(*tp_it);
+      selected_dt_map[selected_dt].push_back(tp);
     }
   }
 
   // Duplicate DT muon primitives
   if (duplicateTheta_) {
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_it  = selected_dt_map.begin();
-    std::map<int, TriggerPrimitiveCollection>::iterator map_tp_end = selected_dt_map.end();
-
-    for (; map_tp_it != map_tp_end; ++map_tp_it) {
-      //int selected = map_tp_it->first;
-      TriggerPrimitiveCollection& tmp_primitives = map_tp_it->second;  // pass by reference
+    for (int selected = selected_dt_map.next(0); selected < emtf::NUM_LINKS; selected = selected_dt_map.next(selected+1)) {
+      PrimitiveLinkTable::link_t& tmp_primitives = selected_dt_map[selected];  // pass by reference
 
       assert(tmp_primitives.size() <= 2);  // at most 2 hits
 
@@ -524,53 +518,45 @@ void PrimitiveSelection::process(
 // supplemental source of stubs for CSCs.
 
 void PrimitiveSelection::merge(
-    const std::map<int, TriggerPrimitiveCollection>& selected_dt_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_csc_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_rpc_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_gem_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_me0_map,
-    std::map<int, TriggerPrimitiveCollection>& selected_prim_map
+    const PrimitiveLinkTable& selected_dt_map,
+    const PrimitiveLinkTable& selected_csc_map,
+    const PrimitiveLinkTable& selected_rpc_map,
+    const PrimitiveLinkTable& selected_gem_map,
+    const PrimitiveLinkTable& selected_me0_map,
+    PrimitiveLinkTable& selected_prim_map
 ) const {
   // First, put CSC hits
-  std::map<int, TriggerPrimitiveCollection>::const_iterator map_tp_it  = selected_csc_map.begin();
-  std::map<int, TriggerPrimitiveCollection>::const_iterator map_tp_end = selected_csc_map.end();
-
-  for (; map_tp_it != map_tp_end; ++map_tp_it) {
-    int selected_csc = map_tp_it->first;
-    const TriggerPrimitiveCollection& csc_primitives = map_tp_it->second;
+  for (int selected_csc = selected_csc_map.next(0); selected_csc < emtf::NUM_LINKS; selected_csc = selected_csc_map.next(selected_csc+1)) {
+    const PrimitiveLinkTable::link_t& csc_primitives = selected_csc_map.at(selected_csc);
     assert(csc_primitives.size() <= 4);  // at most 4 hits, including duplicated hits
 
     // Insert all CSC hits
-    selected_prim_map[selected_csc] = csc_primitives;
+    PrimitiveLinkTable::link_t& tmp_primitives = selected_prim_map[selected_csc];
+    tmp_primitives.assign(csc_primitives.begin(), csc_primitives.end());
   }
 
   // Second, insert GEM/ME0 hits ...
   //FIXME: implement this
 
   // Third, insert RPC stubs if there is no CSC/GEM hits
-  map_tp_it  = selected_rpc_map.begin();
-  map_tp_end = selected_rpc_map.end();
-
-  for (; map_tp_it != map_tp_end; ++map_tp_it) {
-    int selected_rpc = map_tp_it->first;
-    const TriggerPrimitiveCollection& rpc_primitives = map_tp_it->second;
+  for (int selected_rpc = selected_rpc_map.next(0); selected_rpc < emtf::NUM_LINKS; selected_rpc = selected_rpc_map.next(selected_rpc+1)) {
+    const PrimitiveLinkTable::link_t& rpc_primitives = selected_rpc_map.at(selected_rpc);
     if (rpc_primitives.empty())  continue;
     assert(rpc_primitives.size() <= 4);  // at most 4 hits
 
-    bool found = (selected_prim_map.find(selected_rpc) != selected_prim_map.end());
+    bool found = selected_prim_map.has(selected_rpc);
     if (!found) {
       // No CSC/GEM hits, insert all RPC hits
       //selected_prim_map[selected_rpc] = rpc_primitives;
 
       // No CSC/GEM hits, insert the valid RPC hits
-      TriggerPrimitiveCollection tmp_rpc_primitives;
+      PrimitiveLinkTable::link_t& tmp_rpc_primitives = selected_prim_map[selected_rpc];
       for (const auto& tp : rpc_primitives) {
         if (tp.getRPCData().valid != 0) {
           tmp_rpc_primitives.push_back(tp);
         }
       }
       assert(tmp_rpc_primitives.size() <= 2);  // at most 2 hits
-      selected_prim_map[selected_rpc] = tmp_rpc_primitives;
 
     } else {
       // Initial FW in 2017; was disabled on June 7.
@@ -585,33 +571,33 @@ void PrimitiveSelection::merge(
 }
 
 void PrimitiveSelection::merge_no_truncate(
-    const std::map<int, TriggerPrimitiveCollection>& selected_dt_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_csc_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_rpc_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_gem_map,
-    const std::map<int, TriggerPrimitiveCollection>& selected_me0_map,
-    std::map<int, TriggerPrimitiveCollection>& selected_prim_map
+    const PrimitiveLinkTable& selected_dt_map,
+    const PrimitiveLinkTable& selected_csc_map,
+    const PrimitiveLinkTable& selected_rpc_map,
+    const PrimitiveLinkTable& selected_gem_map,
+    const PrimitiveLinkTable& selected_me0_map,
+    PrimitiveLinkTable& selected_prim_map
 ) const {
   // First, put CSC hits
-  merge_map_into_map(selected_csc_map, selected_prim_map);
+  selected_prim_map.merge(selected_csc_map);
 
   // Second, insert GEM hits
-  merge_map_into_map(selected_gem_map, selected_prim_map);
+  selected_prim_map.merge(selected_gem_map);
 
   // Third, insert ME0 hits
-  merge_map_into_map(selected_me0_map, selected_prim_map);
+  selected_prim_map.merge(selected_me0_map);
 
   // Fourth, insert RPC hits
-  merge_map_into_map(selected_rpc_map, selected_prim_map);
+  selected_prim_map.merge(selected_rpc_map);
 
   // Fifth, insert DT hits
-  merge_map_into_map(selected_dt_map, selected_prim_map);
+  selected_prim_map.merge(selected_dt_map);
 }
 
 
 // _____________________________________________________________________________
 // CSC functions
-int PrimitiveSelection::select_csc(const TriggerPrimitive& muon_primitive) const {
+int PrimitiveSelection::select_csc(const TriggerPrimitive& muon_primitive, int bx) const {
   int selected = -1;
 
   if (muon_primitive.subsystem() == TriggerPrimitive::kCSC) {
@@ -631,18 +617,6 @@ int PrimitiveSelection::select_csc(const TriggerPrimitive& muon_primitive) const
     int max_wire  = 0;  // wiregroup
     emtf::get_csc_max_strip_and_wire(tp_station, tp_ring, max_strip, max_wire);
 
-    if (endcap_ == 1 && sector_ == 1 && bx_ == -3) {  // do assertion checks only once
-      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
-      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
-      assert_no_abort(1 <= tp_station && tp_station <= 4);
-      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 9);
-      assert_no_abort(tp_data.strip < max_strip);
-      assert_no_abort(tp_data.keywire < max_wire);
-      assert_no_abort(tp_data.valid == true);
-      assert_no_abort(tp_data.pattern <= 10);
-      //assert_no_abort(tp_data.quality > 0);
-    }
-
     // LogWarning
     if ( !(tp_data.strip < max_strip) ) {
       edm::LogWarning("L1T") << "EMTF CSC format error in station " << tp_station << ", ring " << tp_ring
@@ -660,7 +634,7 @@ int PrimitiveSelection::select_csc(const TriggerPrimitive& muon_primitive) const
     int tp_subsector = (tp_station != 1) ? 0 : ((tp_chamber%6 > 2) ? 1 : 2);
 
     // Check if the chamber belongs to this sector processor at this BX.
-    selected = get_index_csc(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx);
+    selected = get_index_csc(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx, bx);
   }
   return selected;
 }
@@ -689,18 +663,18 @@ bool PrimitiveSelection::is_in_neighbor_sector_csc(int tp_endcap, int tp_sector,
   return false;
 }
 
-bool PrimitiveSelection::is_in_bx_csc(int tp_bx) const {
+bool PrimitiveSelection::is_in_bx_csc(int tp_bx, int bx) const {
   tp_bx += bxShiftCSC_;
-  return (bx_ == tp_bx);
+  return (bx == tp_bx);
 }
 
 // Returns CSC input "link".  Index used by FW for unique chamber identification.
-int PrimitiveSelection::get_index_csc(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx) const {
+int PrimitiveSelection::get_index_csc(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx, int bx) const {
   int selected = -1;
 
   bool is_native   = false;
   bool is_neighbor = false;
-  if (is_in_bx_csc(tp_bx)) {
+  if (is_in_bx_csc(tp_bx, bx)) {
     if (is_in_sector_csc(tp_endcap, tp_sector)) {
       is_native = true;
     } else if (is_in_neighbor_sector_csc(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID)) {
@@ -731,7 +705,7 @@ int PrimitiveSelection::get_index_csc(int tp_endcap, int tp_sector, int tp_subse
 
 // _____________________________________________________________________________
 // RPC functions
-int PrimitiveSelection::select_rpc(const TriggerPrimitive& muon_primitive) const {
+int PrimitiveSelection::select_rpc(const TriggerPrimitive& muon_primitive, int bx) const {
   int selected = -1;
 
   if (muon_primitive.subsystem() == TriggerPrimitive::kRPC) {
@@ -744,35 +718,16 @@ int PrimitiveSelection::select_rpc(const TriggerPrimitive& muon_primitive) const
     int tp_subsector = tp_detId.subsector();  // 1 - 6 (10 degrees in phi; staggered in z)
     int tp_station   = tp_detId.station();    // 1 - 4
     int tp_ring      = tp_detId.ring();       // 2 - 3 (increasing theta)
-    int tp_roll      = tp_detId.roll();       // 1 - 3 (decreasing theta; aka A - C; space between rolls is 9 - 15 in theta_fp)
-    //int tp_layer     = tp_detId.layer();
 
     int tp_bx        = tp_data.bx;
-    int tp_strip     = tp_data.strip;
     int tp_emtf_sect = tp_data.emtf_sector;
     bool tp_CPPF     = tp_data.isCPPF;
 
     // In neighbor chambers, have two separate CPPFDigis for the two EMTF sectors
     if (tp_CPPF && (tp_emtf_sect != sector_)) return selected;
 
-    const bool is_irpc = (tp_station == 3 || tp_station == 4) && (tp_ring == 1);
-
-    if (endcap_ == 1 && sector_ == 1 && bx_ == -3) {  // do assertion checks only once
-      assert_no_abort(tp_region != 0);
-      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
-      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
-      assert_no_abort(1 <= tp_subsector && tp_subsector <= 6);
-      assert_no_abort(1 <= tp_station && tp_station <= 4);
-      assert_no_abort((!is_irpc && 2 <= tp_ring && tp_ring <= 3) || (is_irpc && tp_ring == 1));
-      assert_no_abort((!is_irpc && 1 <= tp_roll && tp_roll <= 3) || (is_irpc && 1 <= tp_roll && tp_roll <= 5));
-      //assert_no_abort((!is_irpc && (tp_CPPF || (1 <= tp_strip && tp_strip <= 32))) || (is_irpc && 1 <= tp_strip && tp_strip <= 96));
-      assert_no_abort((!is_irpc && (tp_CPPF || (1 <= tp_strip && tp_strip <= 32))) || (is_irpc && 1 <= tp_strip && tp_strip <= 96*2));  // in CMSSW, the iRPC chamber has 192 strips
-      //assert_no_abort(tp_station > 2 || tp_ring != 3);  // stations 1 and 2 do not receive RPCs from ring 3
-      assert_no_abort(tp_data.valid == true);
-    }
-
     // Check if the chamber belongs to this sector processor at this BX.
-    selected = get_index_rpc(tp_endcap, tp_station, tp_ring, tp_sector, tp_subsector, tp_bx);
+    selected = get_index_rpc(tp_endcap, tp_station, tp_ring, tp_sector, tp_subsector, tp_bx, bx);
   }
   return selected;
 }
@@ -811,17 +766,17 @@ bool PrimitiveSelection::is_in_neighbor_sector_rpc(int tp_endcap, int tp_station
   return (includeNeighbor_ && (endcap_ == tp_endcap) && (sector_ == tp_sector) && (tp_subsector == get_neighbor_subsector(tp_station, tp_ring)));
 }
 
-bool PrimitiveSelection::is_in_bx_rpc(int tp_bx) const {
+bool PrimitiveSelection::is_in_bx_rpc(int tp_bx, int bx) const {
   tp_bx += bxShiftRPC_;
-  return (bx_ == tp_bx);
+  return (bx == tp_bx);
 }
 
-int PrimitiveSelection::get_index_rpc(int tp_endcap, int tp_station, int tp_ring, int tp_sector, int tp_subsector, int tp_bx) const {
+int PrimitiveSelection::get_index_rpc(int tp_endcap, int tp_station, int tp_ring, int tp_sector, int tp_subsector, int tp_bx, int bx) const {
   int selected = -1;
 
   bool is_native   = false;
   bool is_neighbor = false;
-  if (is_in_bx_rpc(tp_bx)) {
+  if (is_in_bx_rpc(tp_bx, bx)) {
     if (is_in_sector_rpc(tp_endcap, tp_station, tp_ring, tp_sector, tp_subsector)) {
       is_native = true;
     } else if (is_in_neighbor_sector_rpc(tp_endcap, tp_station, tp_ring, tp_sector, tp_subsector)) {
@@ -878,7 +833,7 @@ int PrimitiveSelection::get_index_rpc(int tp_endcap, int tp_station, int tp_ring
 // According to what I know at the moment
 // - GE1/1: 10 degree chamber, 8 rolls, 384 strips = 192 pads
 // - GE2/1: 20 degree chamber, 8 rolls, 768 strips = 384 pads
-int PrimitiveSelection::select_gem(const TriggerPrimitive& muon_primitive) const {
+int PrimitiveSelection::select_gem(const TriggerPrimitive& muon_primitive, int bx) const {
   int selected = -1;
 
   if (muon_primitive.subsystem() == TriggerPrimitive::kGEM) {
@@ -889,12 +844,9 @@ int PrimitiveSelection::select_gem(const TriggerPrimitive& muon_primitive) const
     int tp_endcap    = (tp_region == -1) ? 2 : tp_region;
     int tp_station   = tp_detId.station();
     int tp_ring      = tp_detId.ring();
-    int tp_roll      = tp_detId.roll();
-    int tp_layer     = tp_detId.layer();
     int tp_chamber   = tp_detId.chamber();
 
     int tp_bx        = tp_data.bx;
-    int tp_pad       = ((tp_data.pad_low + tp_data.pad_hi) / 2);
 
     int tp_sector    = emtf::get_trigger_sector(tp_ring, tp_station, tp_chamber);
     int tp_csc_ID    = emtf::get_trigger_csc_ID(tp_ring, tp_station, tp_chamber);
@@ -903,21 +855,8 @@ int PrimitiveSelection::select_gem(const TriggerPrimitive& muon_primitive) const
     // station 2,3,4 --> subsector 0
     int tp_subsector = (tp_station != 1) ? 0 : ((tp_chamber%6 > 2) ? 1 : 2);
 
-    if (endcap_ == 1 && sector_ == 1 && bx_ == -3) {  // do assertion checks only once
-      assert_no_abort(tp_region != 0);
-      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
-      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
-      assert_no_abort(1 <= tp_station && tp_station <= 2);
-      assert_no_abort(tp_ring == 1);
-      assert_no_abort(1 <= tp_roll && tp_roll <= 8);
-      assert_no_abort(1 <= tp_layer && tp_layer <= 2);
-      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 3);
-      assert_no_abort((tp_station == 1 && 1 <= tp_pad && tp_pad <= 192) || (tp_station != 1));
-      assert_no_abort((tp_station == 2 && 1 <= tp_pad && tp_pad <= 384) || (tp_station != 2));
-    }
-
     // Check if the chamber belongs to this sector processor at this BX.
-    selected = get_index_gem(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx);
+    selected = get_index_gem(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx, bx);
   }
   return selected;
 }
@@ -932,17 +871,17 @@ bool PrimitiveSelection::is_in_neighbor_sector_gem(int tp_endcap, int tp_sector,
   return is_in_neighbor_sector_csc(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID);
 }
 
-bool PrimitiveSelection::is_in_bx_gem(int tp_bx) const {
+bool PrimitiveSelection::is_in_bx_gem(int tp_bx, int bx) const {
   tp_bx += bxShiftGEM_;
-  return (bx_ == tp_bx);
+  return (bx == tp_bx);
 }
 
-int PrimitiveSelection::get_index_gem(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx) const {
+int PrimitiveSelection::get_index_gem(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx, int bx) const {
   int selected = -1;
 
   bool is_native   = false;
   bool is_neighbor = false;
-  if (is_in_bx_gem(tp_bx)) {
+  if (is_in_bx_gem(tp_bx, bx)) {
     if (is_in_sector_gem(tp_endcap, tp_sector)) {
       is_native = true;
     } else if (is_in_neighbor_sector_gem(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID)) {
@@ -976,7 +915,7 @@ int PrimitiveSelection::get_index_gem(int tp_endcap, int tp_sector, int tp_subse
 //
 // According to what I know at the moment
 // - ME0: 20 degree chamber, 8 rolls, 384 strips = 192 pads
-int PrimitiveSelection::select_me0(const TriggerPrimitive& muon_primitive) const {
+int PrimitiveSelection::select_me0(const TriggerPrimitive& muon_primitive, int bx) const {
   int selected = -1;
 
   if (muon_primitive.subsystem() == TriggerPrimitive::kME0) {
@@ -986,13 +925,9 @@ int PrimitiveSelection::select_me0(const TriggerPrimitive& muon_primitive) const
     int tp_region    = tp_detId.region();     // 0 for Barrel, +/-1 for +/- Endcap
     int tp_endcap    = (tp_region == -1) ? 2 : tp_region;
     int tp_station   = tp_detId.station();
-    int tp_ring      = 1;  // tp_detId.ring() does not exist
-    int tp_roll      = tp_detId.roll();
-    //int tp_layer     = tp_detId.layer();
     int tp_chamber   = tp_detId.chamber();
 
     int tp_bx        = tp_data.bx;
-    int tp_pad       = tp_data.pad;
 
     // The ME0 geometry is similar to ME2/1, so I use tp_station = 2, tp_ring = 1
     // when calling get_trigger_sector() and get_trigger_csc_ID()
@@ -1000,20 +935,8 @@ int PrimitiveSelection::select_me0(const TriggerPrimitive& muon_primitive) const
     int tp_csc_ID    = emtf::get_trigger_csc_ID(1, 2, tp_chamber);
     int tp_subsector = 0;
 
-    if (endcap_ == 1 && sector_ == 1 && bx_ == -3) {  // do assertion checks only once
-      assert_no_abort(tp_region != 0);
-      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
-      assert_no_abort(emtf::MIN_TRIGSECTOR <= tp_sector && tp_sector <= emtf::MAX_TRIGSECTOR);
-      assert_no_abort(tp_station == 1);
-      assert_no_abort(tp_ring == 1);
-      assert_no_abort(1 <= tp_roll && tp_roll <= 8);
-      //assert_no_abort(1 <= tp_layer && tp_layer <= 6);  // it is currently not set
-      assert_no_abort(1 <= tp_csc_ID && tp_csc_ID <= 3);
-      assert_no_abort(1 <= tp_pad && tp_pad <= 192);
-    }
-
     // Check if the chamber belongs to this sector processor at this BX.
-    selected = get_index_me0(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx);
+    selected = get_index_me0(tp_endcap, tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx, bx);
   }
   return selected;
 }
@@ -1029,17 +952,17 @@ bool PrimitiveSelection::is_in_neighbor_sector_me0(int tp_endcap, int tp_sector,
   return is_in_neighbor_sector_csc(tp_endcap, tp_sector, 0, 2, tp_csc_ID);
 }
 
-bool PrimitiveSelection::is_in_bx_me0(int tp_bx) const {
+bool PrimitiveSelection::is_in_bx_me0(int tp_bx, int bx) const {
   tp_bx += bxShiftGEM_;
-  return (bx_ == tp_bx);
+  return (bx == tp_bx);
 }
 
-int PrimitiveSelection::get_index_me0(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx) const {
+int PrimitiveSelection::get_index_me0(int tp_endcap, int tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx, int bx) const {
   int selected = -1;
 
   bool is_native   = false;
   bool is_neighbor = false;
-  if (is_in_bx_me0(tp_bx)) {
+  if (is_in_bx_me0(tp_bx, bx)) {
     if (is_in_sector_me0(tp_endcap, tp_sector)) {
       is_native = true;
     } else if (is_in_neighbor_sector_me0(tp_endcap, tp_sector, tp_csc_ID)) {
@@ -1061,7 +984,7 @@ int PrimitiveSelection::get_index_me0(int tp_endcap, int tp_sector, int tp_subse
 
 // _____________________________________________________________________________
 // DT functions
-int PrimitiveSelection::select_dt(const TriggerPrimitive& muon_primitive) const {
+int PrimitiveSelection::select_dt(const TriggerPrimitive& muon_primitive, int bx) const {
   int selected = -1;
 
   if (muon_primitive.subsystem() == TriggerPrimitive::kDT) {
@@ -1083,8 +1006,6 @@ int PrimitiveSelection::select_dt(const TriggerPrimitive& muon_primitive) const
     }
 
     int tp_bx        = tp_data.bx;
-    int tp_phi       = tp_data.radialAngle;
-    int tp_phiB      = tp_data.bendingAngle;
 
     // Mimic 10 deg CSC chamber. I use tp_station = 2, tp_ring = 2
     // when calling get_trigger_sector() and get_trigger_csc_ID()
@@ -1094,22 +1015,8 @@ int PrimitiveSelection::select_dt(const TriggerPrimitive& muon_primitive) const
     int tp_csc_ID     = emtf::get_trigger_csc_ID(2, 2, tp_chamber);
     int tp_subsector  = 0;
 
-    if (endcap_ == 1 && sector_ == 1 && bx_ == -3) {  // do assertion checks only once
-      //assert_no_abort(-2 <= tp_wheel && tp_wheel <= +2);
-      assert_no_abort(tp_wheel == -2 || tp_wheel == +2);  // do not include wheels -1, 0, +1
-      //assert_no_abort(1 <= tp_station && tp_station <= 4);
-      assert_no_abort(1 <= tp_station && tp_station <= 3);  // do not include MB4
-      assert_no_abort(1 <= tp_sector && tp_sector <= 12);
-      assert_no_abort(emtf::MIN_ENDCAP <= tp_endcap && tp_endcap <= emtf::MAX_ENDCAP);
-      assert_no_abort(emtf::MIN_TRIGSECTOR <= csc_tp_sector && csc_tp_sector <= emtf::MAX_TRIGSECTOR);
-      //assert_no_abort(4 <= tp_csc_ID && tp_csc_ID <= 9);
-      assert_no_abort(tp_csc_ID == 6 || tp_csc_ID == 9);
-      assert_no_abort(-2048 <= tp_phi && tp_phi <= 2047);  // 12-bit
-      assert_no_abort(-512 <= tp_phiB && tp_phiB <= 511);  // 10-bit
-    }
-
     // Check if the chamber belongs to this sector processor at this BX.
-    selected = get_index_dt(tp_endcap, csc_tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx);
+    selected = get_index_dt(tp_endcap, csc_tp_sector, tp_subsector, tp_station, tp_csc_ID, tp_bx, bx);
   }
   return selected;
 }
@@ -1125,17 +1032,17 @@ bool PrimitiveSelection::is_in_neighbor_sector_dt(int tp_endcap, int tp_sector,
   return is_in_neighbor_sector_csc(tp_endcap, tp_sector, 0, 2, tp_csc_ID);
 }
 
-bool PrimitiveSelection::is_in_bx_dt(int tp_bx) const {
+bool PrimitiveSelection::is_in_bx_dt(int tp_bx, int bx) const {
   //tp_bx += bxShiftDT_;
-  return (bx_ == tp_bx);
+  return (bx == tp_bx);
 }
 
-int PrimitiveSelection::get_index_dt(int tp_endcap, int csc_tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx) const {
+int PrimitiveSelection::get_index_dt(int tp_endcap, int csc_tp_sector, int tp_subsector, int tp_station, int tp_csc_ID, int tp_bx, int bx) const {
   int selected = -1;
 
   bool is_native   = false;
   bool is_neighbor = false;
-  if (is_in_bx_dt(tp_bx)) {
+  if (is_in_bx_dt(tp_bx, bx)) {
     if (is_in_sector_dt(tp_endcap, csc_tp_sector)) {
       is_native = true;
     } else if (is_in_neighbor_sector_dt(tp_endcap, csc_tp_sector, tp_csc_ID)) {
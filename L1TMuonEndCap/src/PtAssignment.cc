@@ -5,9 +5,7 @@
 
 void PtAssignment::configure(
     PtAssignmentEngine* pt_assign_engine,
-    int verbose, int endcap, int sector, int bx,
-    bool readPtLUTFile, bool fixMode15HighPt,
-    bool bug9BitDPhi, bool bugMode7CLCT, bool bugNegPt,
+    int verbose, int endcap, int sector,
     bool bugGMTPhi, bool promoteMode7, int modeQualVer
 ) {
   assert(pt_assign_engine != nullptr);
@@ -17,13 +15,9 @@ void PtAssignment::configure(
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
-  pt_assign_engine_->configure(
-      verbose_,
-      readPtLUTFile, fixMode15HighPt,
-      bug9BitDPhi, bugMode7CLCT, bugNegPt
-  );
+  // The engine is shared by all the sector processors. It is configured by
+  // SectorProcessor::configure_pt_assign_engine(), outside of the sector loop.
 
   bugGMTPhi_    = bugGMTPhi;
   promoteMode7_ = promoteMode7;
@@ -32,7 +26,7 @@ void PtAssignment::configure(
 
 void PtAssignment::process(
     EMTFTrackCollection& best_tracks
-) {
+) const {
   using address_t = PtAssignmentEngine::address_t;
 
   EMTFTrackCollection::iterator best_tracks_it  = best_tracks.begin();
@@ -1,5 +1,6 @@
 #include "L1Trigger/L1TMuonEndCap/interface/PtAssignmentEngine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <sstream>
@@ -10,6 +11,7 @@
 PtAssignmentEngine::PtAssignmentEngine() :
     allowedModes_({3,5,9,6,10,12,7,11,13,14,15}),
     forests_(),
+    flat_forests_(),
     ptlut_reader_(),
     ptLUTVersion_(0xFFFFFFFF)
 {
@@ -39,6 +41,7 @@ void PtAssignmentEngine::read(int pt_lut_version, const std::string& xml_dir) {
     std::stringstream ss;
     ss << xml_dir_full << "/" << mode;
     forests_.at(mode).loadForestFromXML(ss.str().c_str(), xml_nTrees);
+    flat_forests_.at(mode).compile(forests_.at(mode), std::min(xml_nTrees, flat_forest_ntrees_));
   }
 
   return;
@@ -63,6 +66,10 @@ void PtAssignmentEngine::load(int pt_lut_version, const L1TMuonEndCapForest *pay
     // std::cout << "  * ptLUTVersion_ = " << ptLUTVersion_ << std::endl;
     forests_.at(mode).getTree(0)->setBoostWeight( boostWeight_ );
 
+    // Flatten the trees once here, so that calculate_pt_xml does not walk the Node pointers.
+    // Only the first flat_forest_ntrees_ trees are used, the same as the former predictEvent().
+    flat_forests_.at(mode).compile(forests_.at(mode), flat_forest_ntrees_);
+
     //assert(boostWeight_ == 0 || ptLUTVersion_ >= 6);  // Check that XMLs and pT LUT version are consistent
     // Will catch user trying to run with Global Tag settings on 2017 data, rather than fakeEmtfParams. - AWB 08.06.17
 
@@ -105,6 +112,11 @@ void PtAssignmentEngine::configure_details() {
   }
 }
 
+// Must be called before configure(), which reads the LUT file
+void PtAssignmentEngine::configure_ptlut_reader(bool mmapPtLUTFile, bool populatePtLUTFile) {
+  ptlut_reader_.configure(mmapPtLUTFile, populatePtLUTFile);
+}
+
 const PtAssignmentEngineAux& PtAssignmentEngine::aux() const {
   static const PtAssignmentEngineAux instance;
   return instance;
@@ -130,6 +142,20 @@ float PtAssignmentEngine::calculate_pt(const EMTFTrack& track) const {
   return pt;
 }
 
+void PtAssignmentEngine::calculate_pt_batch(const address_t* addresses, unsigned int n, float* pts) const {
+  if (readPtLUTFile_) {
+    for (unsigned int i = 0; i < n; ++i)
+      pts[i] = calculate_pt_lut(addresses[i]);
+  } else {
+    calculate_pt_xml_batch(addresses, n, pts);
+  }
+}
+
+void PtAssignmentEngine::calculate_pt_xml_batch(const address_t* addresses, unsigned int n, float* pts) const {
+  for (unsigned int i = 0; i < n; ++i)
+    pts[i] = calculate_pt_xml(addresses[i]);
+}
+
 float PtAssignmentEngine::calculate_pt_lut(const address_t& address) const {
   // LUT outputs 'gmt_pt', so need to convert back to 'xmlpt'
   int gmt_pt = ptlut_reader_.lookup(address);
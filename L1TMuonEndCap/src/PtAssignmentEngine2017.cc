@@ -2,6 +2,7 @@
 #include "L1Trigger/L1TMuonEndCap/interface/PtAssignmentEngineAux2017.h"
 #include "L1Trigger/L1TMuonEndCap/interface/PtLUTVarCalc.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <sstream>
@@ -204,8 +205,107 @@ PtAssignmentEngine::address_t PtAssignmentEngine2017::calculate_address(const EM
 } // End function: PtAssignmentEngine2017::calculate_address()
 
 
+// Smallest address that unpacks to the same BDT input variables, hence the same pT, as this one
+PtAssignmentEngine2017::address_t PtAssignmentEngine2017::canonical_address(const address_t& address) const {
+  // All the addresses below 2^24 have no valid mode and get the same pT
+  if (address < pow(2, 24))
+    return 0;
+
+  // Map each mode15_8b word to the smallest word with the same unpacked values
+  static const std::array<int, 256> mode15_8b_canonical = []() {
+    const PtAssignmentEngineAux2017 aux2017;
+    std::array<int, 256> canonical;
+    std::vector<std::array<int, 7> > unpacked(256);
+    for (int i = 0; i < 256; ++i) {
+      int theta, st1_ring2, clctA, rpcA, rpcB, rpcC, rpcD;
+      aux2017.unpack8bMode15( i, theta, st1_ring2, 1, 1, clctA, rpcA, rpcB, rpcC, rpcD );
+      unpacked[i] = {{ theta, st1_ring2, clctA, rpcA, rpcB, rpcC, rpcD }};
+      canonical[i] = std::find(unpacked.begin(), unpacked.begin() + i, unpacked[i]) - unpacked.begin();
+    }
+    return canonical;
+  }();
+
+  address_t canonical = address;
+
+  if (address >= pow(2, 29)) {  // 4 hits
+    // A dPhi of zero has no sign
+    int dPhiBC    = (address >> (0+7)               & ((1<<5)-1));
+    int dPhiCD    = (address >> (0+7+5)             & ((1<<4)-1));
+    int mode15_8b = (address >> (0+7+5+4+1+1+2+1)   & ((1<<8)-1));
+    if (aux().getdPhiFromBin( dPhiBC, 5, 256 ) == 0)
+      canonical &= ~(address_t(1) << (0+7+5+4));
+    if (aux().getdPhiFromBin( dPhiCD, 4, 256 ) == 0)
+      canonical &= ~(address_t(1) << (0+7+5+4+1));
+
+    canonical &= ~(address_t((1<<8)-1) << (0+7+5+4+1+1+2+1));
+    canonical |= address_t(mode15_8b_canonical[mode15_8b]) << (0+7+5+4+1+1+2+1);
+  }
+  else if (address >= pow(2, 26)) {  // 3 hits
+    int dPhiBC    = (address >> (0+7)               & ((1<<5)-1));
+    if (aux().getdPhiFromBin( dPhiBC, 5, 256 ) == 0)
+      canonical &= ~(address_t(1) << (0+7+5));
+  }
+
+  assert(canonical <= address);
+  return canonical;
+} // End function: PtAssignmentEngine2017::canonical_address()
+
+
 // Calculate XML pT from address
 float PtAssignmentEngine2017::calculate_pt_xml(const address_t& address) const {
+  float pt_xml = 0.;
+
+  predictors_t predictors{};
+  int mode = calculate_predictors(address, predictors);
+  if (mode <= 0)
+    return pt_xml;
+
+  // // Adjust this for different XMLs
+  // float log2_pt = predict_xml(mode, predictors);
+  // pt_xml = pow(2, fmax(0.0, log2_pt)); // Protect against negative values
+
+  float inv_pt = predict_xml(mode, predictors);
+  pt_xml = 1.0 / fmax(0.001, inv_pt); // Protect against negative values
+
+  return pt_xml;
+
+} // End function: float PtAssignmentEngine2017::calculate_pt_xml(const address_t& address)
+
+
+// Calculate XML pT for many addresses, evaluating consecutive addresses of the same mode in one batch
+void PtAssignmentEngine2017::calculate_pt_xml_batch(const address_t* addresses, unsigned int n, float* pts) const {
+  std::vector<predictors_t> predictors(n);
+  std::vector<int> modes(n);
+  std::vector<double> inv_pts(n);
+
+  for (unsigned int i = 0; i < n; ++i) {
+    modes[i] = calculate_predictors(addresses[i], predictors[i]);
+  }
+
+  unsigned int first = 0;
+  while (first < n) {
+    unsigned int last = first + 1;
+    while (last < n && modes[last] == modes[first])
+      ++last;
+
+    if (modes[first] > 0) {
+      flat_forests_.at(modes[first]).predictBatch(predictors[first].data(), predictors_t().size(), last - first, &inv_pts[first]);
+      for (unsigned int i = first; i < last; ++i) {
+        float inv_pt = inv_pts[i];
+        pts[i] = 1.0 / fmax(0.001, inv_pt); // Protect against negative values
+      }
+    } else {
+      for (unsigned int i = first; i < last; ++i) {
+        pts[i] = 0.;
+      }
+    }
+    first = last;
+  }
+}
+
+
+// Unpack the pT LUT address into the BDT input variables, returns the track mode (0 if not a valid address)
+int PtAssignmentEngine2017::calculate_predictors(const address_t& address, predictors_t& predictors) const {
 
   // std::cout << "Inside calculate_pt_xml, examining address: ";
   // for (int j = 0; j < 30; j++) {
@@ -214,15 +314,16 @@ float PtAssignmentEngine2017::calculate_pt_xml(const address_t& address) const {
   // }
   // std::cout << std::endl;
 
-  float pt_xml  = 0.;
   int nHits = -1, mode = -1;
 
+  predictors.fill(0);  // also on the assert(false) path below
+
   assert(address < pow(2, 30));
   if      (address >= pow(2, 29)) { nHits = 4; mode = 15; }
   else if (address >= pow(2, 27)) { nHits = 3;            }
   else if (address >= pow(2, 26)) { nHits = 3; mode =  7; }
   else if (address >= pow(2, 24)) { nHits = 2;            }
-  else return pt_xml;
+  else return 0;
 
   // Variables to unpack from the pT LUT address
   int mode_ID, theta, dTheta;
@@ -346,66 +447,44 @@ float PtAssignmentEngine2017::calculate_pt_xml(const address_t& address) const {
 
   // Fill vectors of variables for XMLs
   // KK: sequence of variables here should exaclty match <Variables> block produced by TMVA
-  std::vector<int> predictors;
-
   // Variables for input to XMLs
   int dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi;
 
   // Convert words into variables for XMLs
   if      (nHits == 4) {
-    predictors = { theta, St1_ring2, dPhiAB, dPhiBC, dPhiCD, dPhiAB + dPhiBC,
-                   dPhiAB + dPhiBC + dPhiCD, dPhiBC + dPhiCD, frA, clctA };
-
     CalcDeltaPhiSums( dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi,
                       dPhiAB, dPhiAB + dPhiBC, dPhiAB + dPhiBC + dPhiCD,
                       dPhiBC, dPhiBC + dPhiCD, dPhiCD );
 
-    int tmp[10] = {dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi, dTheta, rpcA, rpcB, rpcC, rpcD };
-    predictors.insert( predictors.end(), tmp, tmp+10 );
+    predictors = {{ theta, St1_ring2, dPhiAB, dPhiBC, dPhiCD, dPhiAB + dPhiBC,
+                    dPhiAB + dPhiBC + dPhiCD, dPhiBC + dPhiCD, frA, clctA,
+                    dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi, dTheta, rpcA, rpcB, rpcC, rpcD }};
   }
   else if (nHits == 3) {
     if      (mode == 14)
-      predictors = { theta, St1_ring2, dPhiAB, dPhiBC, dPhiAB + dPhiBC,
-                     frA, frB, clctA, dTheta, rpcA, rpcB, rpcC };
+      predictors = {{ theta, St1_ring2, dPhiAB, dPhiBC, dPhiAB + dPhiBC,
+                      frA, frB, clctA, dTheta, rpcA, rpcB, rpcC }};
     else if (mode == 13)
-      predictors = { theta, St1_ring2, dPhiAB, dPhiAB + dPhiBC, dPhiBC,
-                     frA, frB, clctA, dTheta, rpcA, rpcB, rpcC };
+      predictors = {{ theta, St1_ring2, dPhiAB, dPhiAB + dPhiBC, dPhiBC,
+                      frA, frB, clctA, dTheta, rpcA, rpcB, rpcC }};
     else if (mode == 11)
-      predictors = { theta, St1_ring2, dPhiBC, dPhiAB, dPhiAB + dPhiBC,
-                     frA, frB, clctA, dTheta, rpcA, rpcB, rpcC };
+      predictors = {{ theta, St1_ring2, dPhiBC, dPhiAB, dPhiAB + dPhiBC,
+                      frA, frB, clctA, dTheta, rpcA, rpcB, rpcC }};
     else if (mode ==  7)
-      predictors = { theta,            dPhiAB, dPhiBC, dPhiAB + dPhiBC,
-                     frA,      clctA, dTheta, rpcA, rpcB, rpcC };
+      predictors = {{ theta,            dPhiAB, dPhiBC, dPhiAB + dPhiBC,
+                      frA,      clctA, dTheta, rpcA, rpcB, rpcC }};
   }
   else if (nHits == 2 && mode >= 8) {
-    predictors = { theta, St1_ring2, dPhiAB, frA, frB, clctA, clctB, dTheta, (clctA == 0), (clctB == 0) };
+    predictors = {{ theta, St1_ring2, dPhiAB, frA, frB, clctA, clctB, dTheta, (clctA == 0), (clctB == 0) }};
   }
   else if (nHits == 2 && mode <  8) {
-    predictors = { theta,            dPhiAB, frA, frB, clctA, clctB, dTheta, (clctA == 0), (clctB == 0) };
+    predictors = {{ theta,            dPhiAB, frA, frB, clctA, clctB, dTheta, (clctA == 0), (clctB == 0) }};
   }
   else assert (false && "Incorrect nHits or mode");
 
-  // Retreive pT from XMLs
-  std::vector<double> tree_data(predictors.cbegin(),predictors.cend());
-
-  auto tree_event = std::make_unique<emtf::Event>();
-  tree_event->predictedValue = 0;
-  tree_event->data = tree_data;
-
-  // forests_.at(mode).predictEvent(tree_event.get(), 400);
-  emtf::Forest &forest = const_cast<emtf::Forest&>(forests_.at(mode));
-  forest.predictEvent(tree_event.get(), 400);
+  return mode;
 
-  // // Adjust this for different XMLs
-  // float log2_pt = tree_event->predictedValue;
-  // pt_xml = pow(2, fmax(0.0, log2_pt)); // Protect against negative values
-
-  float inv_pt = tree_event->predictedValue;
-  pt_xml = 1.0 / fmax(0.001, inv_pt); // Protect against negative values
-
-  return pt_xml;
-
-} // End function: float PtAssignmentEngine2017::calculate_pt_xml(const address_t& address)
+} // End function: int PtAssignmentEngine2017::calculate_predictors(const address_t& address, predictors_t& predictors)
 
 
 // Calculate XML pT directly from track quantities, without forming an address
@@ -513,52 +592,46 @@ float PtAssignmentEngine2017::calculate_pt_xml(const EMTFTrack& track) const {
 
   // Fill vectors of variables for XMLs
   // KK: sequence of variables here should exaclty match <Variables> block produced by TMVA
-  std::vector<int> predictors;
+  predictors_t predictors{};
   switch (mode) {
   case 15: // 1-2-3-4
-    predictors = { theta, St1_ring2, dPhi_12, dPhi_23, dPhi_34, dPhi_13, dPhi_14, dPhi_24, FR_1, bend_1,
-                   dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi, dTh_14, RPC_1, RPC_2, RPC_3, RPC_4 };
+    predictors = {{ theta, St1_ring2, dPhi_12, dPhi_23, dPhi_34, dPhi_13, dPhi_14, dPhi_24, FR_1, bend_1,
+                    dPhiSum4, dPhiSum4A, dPhiSum3, dPhiSum3A, outStPhi, dTh_14, RPC_1, RPC_2, RPC_3, RPC_4 }};
     break;
   case 14: // 1-2-3
-    predictors = { theta, St1_ring2, dPhi_12, dPhi_23, dPhi_13, FR_1, FR_2, bend_1, dTh_13, RPC_1, RPC_2, RPC_3 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_12, dPhi_23, dPhi_13, FR_1, FR_2, bend_1, dTh_13, RPC_1, RPC_2, RPC_3 }}; break;
   case 13: // 1-2-4
-    predictors = { theta, St1_ring2, dPhi_12, dPhi_14, dPhi_24, FR_1, FR_2, bend_1, dTh_14, RPC_1, RPC_2, RPC_4 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_12, dPhi_14, dPhi_24, FR_1, FR_2, bend_1, dTh_14, RPC_1, RPC_2, RPC_4 }}; break;
   case 11: // 1-3-4
-    predictors = { theta, St1_ring2, dPhi_34, dPhi_13, dPhi_14, FR_1, FR_3, bend_1, dTh_14, RPC_1, RPC_3, RPC_4 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_34, dPhi_13, dPhi_14, FR_1, FR_3, bend_1, dTh_14, RPC_1, RPC_3, RPC_4 }}; break;
   case  7: // 2-3-4
-    predictors = { theta,            dPhi_23, dPhi_34, dPhi_24, FR_2,       bend_2, dTh_24, RPC_2, RPC_3, RPC_4 }; break;
+    predictors = {{ theta,            dPhi_23, dPhi_34, dPhi_24, FR_2,       bend_2, dTh_24, RPC_2, RPC_3, RPC_4 }}; break;
   case 12: // 1-2
-    predictors = { theta, St1_ring2, dPhi_12, FR_1, FR_2, bend_1, bend_2, dTh_12, RPC_1, RPC_2 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_12, FR_1, FR_2, bend_1, bend_2, dTh_12, RPC_1, RPC_2 }}; break;
   case 10: // 1-3
-    predictors = { theta, St1_ring2, dPhi_13, FR_1, FR_3, bend_1, bend_3, dTh_13, RPC_1, RPC_3 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_13, FR_1, FR_3, bend_1, bend_3, dTh_13, RPC_1, RPC_3 }}; break;
   case  9: // 1-4
-    predictors = { theta, St1_ring2, dPhi_14, FR_1, FR_4, bend_1, bend_4, dTh_14, RPC_1, RPC_4 }; break;
+    predictors = {{ theta, St1_ring2, dPhi_14, FR_1, FR_4, bend_1, bend_4, dTh_14, RPC_1, RPC_4 }}; break;
   case  6: // 2-3
-    predictors = { theta,            dPhi_23, FR_2, FR_3, bend_2, bend_3, dTh_23, RPC_2, RPC_3 }; break;
+    predictors = {{ theta,            dPhi_23, FR_2, FR_3, bend_2, bend_3, dTh_23, RPC_2, RPC_3 }}; break;
   case  5: // 2-4
-    predictors = { theta,            dPhi_24, FR_2, FR_4, bend_2, bend_4, dTh_24, RPC_2, RPC_4 }; break;
+    predictors = {{ theta,            dPhi_24, FR_2, FR_4, bend_2, bend_4, dTh_24, RPC_2, RPC_4 }}; break;
   case  3: // 3-4
-    predictors = { theta,            dPhi_34, FR_3, FR_4, bend_3, bend_4, dTh_34, RPC_3, RPC_4 }; break;
+    predictors = {{ theta,            dPhi_34, FR_3, FR_4, bend_3, bend_4, dTh_34, RPC_3, RPC_4 }}; break;
   }
 
-  std::vector<double> tree_data(predictors.cbegin(),predictors.cend());
-
-  auto tree_event = std::make_unique<emtf::Event>();
-  tree_event->predictedValue = 0;
-  tree_event->data = tree_data;
-
-  // forests_.at(mode).predictEvent(tree_event.get(), 400);
-  emtf::Forest &forest = const_cast<emtf::Forest&>(forests_.at(mode));
-  forest.predictEvent(tree_event.get(), 400);
-
   // // Adjust this for different XMLs
-  // float log2_pt = tree_event->predictedValue;
+  // float log2_pt = predict_xml(mode, predictors);
   // pt_xml = pow(2, fmax(0.0, log2_pt)); // Protect against negative values
 
-  float inv_pt = tree_event->predictedValue;
+  float inv_pt = predict_xml(mode, predictors);
   pt_xml = 1.0 / fmax(0.001, inv_pt); // Protect against negative values
 
   return pt_xml;
 
 } // End function: float PtAssignmentEngine2017::calculate_pt_xml(const EMTFTrack& track)
 
+// Evaluate the compiled forest for this mode, see PtAssignmentEngine::load()
+float PtAssignmentEngine2017::predict_xml(int mode, const predictors_t& predictors) const {
+  return flat_forests_.at(mode).predict(predictors.data());
+}
@@ -4,23 +4,44 @@
 #include <iostream>
 #include <stdexcept>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #define PTLUT_SIZE (1<<30)
 
 PtLUTReader::PtLUTReader() :
     ptlut_(),
     version_(4),
-    ok_(false)
+    ok_(false),
+    use_mmap_(false),
+    populate_(false),
+    mapped_(nullptr),
+    mapped_size_(0)
 {
 
 }
 
 PtLUTReader::~PtLUTReader() {
+  if (mapped_ != nullptr) {
+    munmap(const_cast<uint64_t*>(mapped_), mapped_size_);
+  }
+}
 
+void PtLUTReader::configure(bool useMmap, bool populate) {
+  use_mmap_ = useMmap;
+  populate_ = populate;
 }
 
 void PtLUTReader::read(const std::string& lut_full_path) {
   if (ok_)  return;
 
+  if (use_mmap_) {
+    read_mmap(lut_full_path);
+    return;
+  }
+
   std::cout << "EMTF emulator: attempting to read pT LUT binary file from local area" << std::endl;
   std::cout << lut_full_path << std::endl;
   std::cout << "Non-standard operation; if it fails, now you know why" << std::endl;
@@ -64,6 +85,77 @@ void PtLUTReader::read(const std::string& lut_full_path) {
   return;
 }
 
+void PtLUTReader::read_mmap(const std::string& lut_full_path) {
+  std::cout << "EMTF emulator: attempting to map pT LUT binary file from local area" << std::endl;
+  std::cout << lut_full_path << std::endl;
+  std::cout << "Non-standard operation; if it fails, now you know why" << std::endl;
+  std::cout << "Be sure to check that the 'scale_pt' function still matches this LUT" << std::endl;
+
+  int fd = open(lut_full_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    char what[256];
+    snprintf(what, sizeof(what), "Fail to open %s", lut_full_path.c_str());
+    throw std::invalid_argument(what);
+  }
+
+  // Each 64-bit word of the file holds 4 LUT entries
+  const size_t expected_size = (PTLUT_SIZE / 4) * sizeof(uint64_t);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != expected_size) {
+    close(fd);
+    char what[256];
+    snprintf(what, sizeof(what), "file size of %s is not %lu", lut_full_path.c_str(), expected_size);
+    throw std::invalid_argument(what);
+  }
+
+  // A shared read-only mapping is backed by the page cache, so all the jobs on
+  // the same node that map this file share one physical copy
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  if (populate_)
+    flags |= MAP_POPULATE;
+#endif
+
+  void* addr = mmap(nullptr, expected_size, PROT_READ, flags, fd, 0);
+  close(fd);  // the mapping keeps its own reference to the file
+
+  if (addr == MAP_FAILED) {
+    char what[256];
+    snprintf(what, sizeof(what), "Fail to mmap %s", lut_full_path.c_str());
+    throw std::invalid_argument(what);
+  }
+
+  // Only hints: failures are harmless
+  if (populate_) {
+#ifdef MADV_HUGEPAGE
+    madvise(addr, expected_size, MADV_HUGEPAGE);
+#endif
+  } else {
+    madvise(addr, expected_size, MADV_RANDOM);  // lookups are scattered, do not read ahead
+  }
+
+  mapped_ = static_cast<const uint64_t*>(addr);
+  mapped_size_ = expected_size;
+
+  version_ = lookup(0);  // address 0 is the pT LUT version number
+  ok_ = true;
+  return;
+}
+
 PtLUTReader::content_t PtLUTReader::lookup(const address_t& address) const {
+  if (mapped_ != nullptr) {
+    if (address >= PTLUT_SIZE) {
+      char what[256];
+      snprintf(what, sizeof(what), "address %lu is out of range", address);
+      throw std::out_of_range(what);
+    }
+
+    // Same packing as in PtLUTWriter::write
+    static const unsigned shifts[4] = {0, 9, 32, 32+9};
+    const uint64_t full_word = mapped_[address >> 2];
+    return (full_word >> shifts[address & 0x3]) & 0x1FF;  // 9-bit
+  }
+
   return ptlut_.at(address);
 }
@@ -21,7 +21,6 @@ PtLUTWriter::~PtLUTWriter() {
 
 void PtLUTWriter::write(const std::string& lut_full_path, const uint16_t num_, const uint16_t denom_) const {
   //if (ok_)  return;
-  assert(denom_ == 64); // Check consistency for temporary hack - AWB 24.05.17
 
   std::cout << "Writing LUT, this might take a while..." << std::endl;
 
@@ -34,7 +33,7 @@ void PtLUTWriter::write(const std::string& lut_full_path, const uint16_t num_, c
 
   if (ptlut_.size() != (PTLUT_SIZE / denom_)) {
     char what[256];
-    snprintf(what, sizeof(what), "ptlut_.size() is %lu != %i", ptlut_.size(), PTLUT_SIZE);
+    snprintf(what, sizeof(what), "ptlut_.size() is %lu != %i", ptlut_.size(), PTLUT_SIZE / denom_);
     throw std::invalid_argument(what);
   }
 
@@ -45,6 +44,10 @@ void PtLUTWriter::write(const std::string& lut_full_path, const uint16_t num_, c
   full_word_t full_word;
   full_word_t sub_word[4] = {0, 0, 0, 0};
 
+  // Pack into a buffer and write it out in blocks rather than 8 bytes at a time
+  std::vector<full_word_t> buffer;
+  buffer.reserve(1<<16);
+
   table_t::const_iterator ptlut_it  = ptlut_.begin();
   table_t::const_iterator ptlut_end = ptlut_.end();
 
@@ -60,7 +63,11 @@ void PtLUTWriter::write(const std::string& lut_full_path, const uint16_t num_, c
     full_word |= ((sub_word[2] & 0x1FF) << 32);
     full_word |= ((sub_word[3] & 0x1FF) << (32+9));
 
-    outfile.write(reinterpret_cast<char*>(&full_word), sizeof(full_word_t));
+    buffer.push_back(full_word);
+    if (buffer.size() == buffer.capacity() || ptlut_it == ptlut_end) {
+      outfile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(full_word_t));
+      buffer.clear();
+    }
   }
   outfile.close();
 
@@ -71,3 +78,7 @@ void PtLUTWriter::write(const std::string& lut_full_path, const uint16_t num_, c
 void PtLUTWriter::push_back(const content_t& pt) {
   ptlut_.push_back(pt);
 }
+
+void PtLUTWriter::resize(const address_t& n) {
+  ptlut_.assign(n, 0);
+}
@@ -1,5 +1,7 @@
 #include "L1Trigger/L1TMuonEndCap/interface/SectorProcessor.h"
 
+#include <algorithm>
+
 
 SectorProcessor::SectorProcessor() {
 
@@ -18,7 +20,7 @@ void SectorProcessor::configure(
     int minBX, int maxBX, int bxWindow, int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
     std::string era,
     const std::vector<int>& zoneBoundaries, int zoneOverlap,
-    bool includeNeighbor, bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges,
+    bool includeNeighbor, bool duplicateTheta, bool fixZonePhi, bool useNewZones, bool fixME11Edges, bool fillSimCoords,
     const std::vector<std::string>& pattDefinitions, const std::vector<std::string>& symPattDefinitions, bool useSymPatterns,
     int thetaWindow, int thetaWindowZone0, bool useRPC, bool useSingleHits, bool bugSt2PhDiff, bool bugME11Dupes, bool bugAmbigThetaWin, bool twoStationSameBX,
     int maxRoadsPerZone, int maxTracks, bool useSecondEarliest, bool bugSameSectorPt0,
@@ -57,6 +59,7 @@ void SectorProcessor::configure(
   fixZonePhi_         = fixZonePhi;
   useNewZones_        = useNewZones;
   fixME11Edges_       = fixME11Edges;
+  fillSimCoords_      = fillSimCoords;
 
   pattDefinitions_    = pattDefinitions;
   symPattDefinitions_ = symPattDefinitions;
@@ -84,10 +87,25 @@ void SectorProcessor::configure(
   bugGMTPhi_          = bugGMTPhi;
   promoteMode7_       = promoteMode7;
   modeQualVer_        = modeQualVer;
+
+  fw_version_         = 0xFFFFFFFF;
+
+  configure_stages();
 }
 
-// Refer to docs/EMTF_FW_LUT_versions_2016_draft2.xlsx
 void SectorProcessor::configure_by_fw_version(unsigned fw_version) {
+  if (fw_version_ == fw_version)  // already configured for this firmware version
+    return;
+  fw_version_ = fw_version;
+
+  configure_params_by_fw_version(fw_version);
+
+  // Rebuild the pipeline stages with the new settings
+  configure_stages();
+}
+
+// Refer to docs/EMTF_FW_LUT_versions_2016_draft2.xlsx
+void SectorProcessor::configure_params_by_fw_version(unsigned fw_version) {
   if (verbose_ > 0) {
     std::cout << "Configure SectorProcessor with fw_version: " << fw_version << std::endl;
   }
@@ -363,9 +381,78 @@ void SectorProcessor::configure_by_fw_version(unsigned fw_version) {
 
 }
 
+void SectorProcessor::configure_stages() {
+  prim_sel_.configure(
+      verbose_, endcap_, sector_,
+      bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
+      includeNeighbor_, duplicateTheta_,
+      bugME11Dupes_
+  );
+
+  prim_conv_.configure(
+      tp_geom_, lut_,
+      verbose_, endcap_, sector_,
+      bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
+      zoneBoundaries_, zoneOverlap_,
+      duplicateTheta_, fixZonePhi_, useNewZones_, fixME11Edges_,
+      bugME11Dupes_, fillSimCoords_
+  );
+
+  patt_recog_.configure(
+      verbose_, endcap_, sector_,
+      bxWindow_,
+      pattDefinitions_, symPattDefinitions_, useSymPatterns_,
+      maxRoadsPerZone_, useSecondEarliest_
+  );
+
+  prim_match_.configure(
+      verbose_, endcap_, sector_,
+      fixZonePhi_, useNewZones_,
+      bugSt2PhDiff_, bugME11Dupes_
+  );
+
+  angle_calc_.configure(
+      verbose_, endcap_, sector_,
+      bxWindow_,
+      thetaWindow_, thetaWindowZone0_,
+      bugME11Dupes_, bugAmbigThetaWin_, twoStationSameBX_
+  );
+
+  btrack_sel_.configure(
+      verbose_, endcap_, sector_,
+      bxWindow_,
+      maxRoadsPerZone_, maxTracks_, useSecondEarliest_,
+      bugSameSectorPt0_
+  );
+
+  single_hit_.configure(
+      verbose_, endcap_, sector_,
+      maxTracks_,
+      useSingleHits_
+  );
+
+  pt_assign_.configure(
+      pt_assign_engine_,
+      verbose_, endcap_, sector_,
+      bugGMTPhi_, promoteMode7_, modeQualVer_
+  );
+
+  extended_conv_hits_.configure(bxWindow_);
+  extended_best_track_cands_.configure(bxWindow_);
+}
+
+void SectorProcessor::configure_pt_assign_engine() const {
+  pt_assign_engine_->configure(
+      verbose_,
+      readPtLUTFile_, fixMode15HighPt_,
+      bug9BitDPhi_, bugMode7CLCT_, bugNegPt_
+  );
+}
+
 void SectorProcessor::process(
     EventNumber_t ievent,
     const TriggerPrimitiveCollection& muon_primitives,
+    const EMTFPrimitiveIndex& prim_index,
     EMTFHitCollection& out_hits,
     EMTFTrackCollection& out_tracks
 ) const {
@@ -485,14 +572,18 @@ void SectorProcessor::process(
 
   // ___________________________________________________________________________
   // List of converted hits, extended from previous BXs
-  // deque (double-ended queue) is similar to a vector, but allows insertion or deletion of elements at both beginning and end
-  std::deque<EMTFHitCollection> extended_conv_hits;
+  BXWindow<EMTFHitCollection>& extended_conv_hits = extended_conv_hits_;
+  extended_conv_hits.clear();
 
   // List of best track candidates, extended from previous BXs
-  std::deque<EMTFTrackCollection> extended_best_track_cands;
+  BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands = extended_best_track_cands_;
+  extended_best_track_cands.clear();
+
+  // Pattern detector lifetimes, tracked across BXs
+  PatternLifetime patt_lifetime;
 
-  // Map of pattern detector --> lifetime, tracked across BXs
-  std::map<pattern_ref_t, int> patt_lifetime_map;
+  // Converted hits in the BX window, as used in track building
+  ConvHitStore& conv_hit_store = conv_hit_store_;
 
   // ___________________________________________________________________________
   // Run each sector processor for every BX, taking into account the BX window
@@ -507,19 +598,19 @@ void SectorProcessor::process(
     process_single_bx(
         bx,
         muon_primitives,
+        prim_index,
         out_hits,
         out_tracks,
         extended_conv_hits,
         extended_best_track_cands,
-        patt_lifetime_map
+        patt_lifetime,
+        conv_hit_store
     );
 
     // Drop earliest BX outside of BX window
     if (bx >= minBX_ + delayBX) {
       extended_conv_hits.pop_front();
-
-      int n = emtf::zone_array<int>().size();
-      extended_best_track_cands.erase(extended_best_track_cands.end()-n, extended_best_track_cands.end());  // pop_back
+      extended_best_track_cands.pop_front();
     }
   }  // end loop over bx
 
@@ -549,97 +640,73 @@ void SectorProcessor::process(
 void SectorProcessor::process_single_bx(
     int bx,
     const TriggerPrimitiveCollection& muon_primitives,
+    const EMTFPrimitiveIndex& prim_index,
     EMTFHitCollection& out_hits,
     EMTFTrackCollection& out_tracks,
-    std::deque<EMTFHitCollection>& extended_conv_hits,
-    std::deque<EMTFTrackCollection>& extended_best_track_cands,
-    std::map<pattern_ref_t, int>& patt_lifetime_map
+    BXWindow<EMTFHitCollection>& extended_conv_hits,
+    BXWindow<emtf::zone_array<EMTFTrackCollection> >& extended_best_track_cands,
+    PatternLifetime& patt_lifetime,
+    ConvHitStore& conv_hit_store
 ) const {
 
-  // ___________________________________________________________________________
-  // Configure
-
-  PrimitiveSelection prim_sel;
-  prim_sel.configure(
-      verbose_, endcap_, sector_, bx,
-      bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
-      includeNeighbor_, duplicateTheta_,
-      bugME11Dupes_
-  );
-
-  PrimitiveConversion prim_conv;
-  prim_conv.configure(
-      tp_geom_, lut_,
-      verbose_, endcap_, sector_, bx,
-      bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
-      zoneBoundaries_, zoneOverlap_,
-      duplicateTheta_, fixZonePhi_, useNewZones_, fixME11Edges_,
-      bugME11Dupes_
-  );
-
-  PatternRecognition patt_recog;
-  patt_recog.configure(
-      verbose_, endcap_, sector_, bx,
-      bxWindow_,
-      pattDefinitions_, symPattDefinitions_, useSymPatterns_,
-      maxRoadsPerZone_, useSecondEarliest_
-  );
-
-  PrimitiveMatching prim_match;
-  prim_match.configure(
-      verbose_, endcap_, sector_, bx,
-      fixZonePhi_, useNewZones_,
-      bugSt2PhDiff_, bugME11Dupes_
-  );
-
-  AngleCalculation angle_calc;
-  angle_calc.configure(
-      verbose_, endcap_, sector_, bx,
-      bxWindow_,
-      thetaWindow_, thetaWindowZone0_,
-      bugME11Dupes_, bugAmbigThetaWin_, twoStationSameBX_
-  );
-
-  BestTrackSelection btrack_sel;
-  btrack_sel.configure(
-      verbose_, endcap_, sector_, bx,
-      bxWindow_,
-      maxRoadsPerZone_, maxTracks_, useSecondEarliest_,
-      bugSameSectorPt0_
-  );
-
-  SingleHitTrack single_hit;
-  single_hit.configure(
-      verbose_, endcap_, sector_, bx,
-      maxTracks_,
-      useSingleHits_
-  );
+  // Fast path for an empty BX: no candidate primitives for this sector and BX,
+  // no hits or track candidates left in the BX window, and no pattern alive.
+  // Every stage would exit early without output, so only the (empty) slots of
+  // this BX are opened in the BX window.
+  if (!prim_index.is_occupied(endcap_, sector_, bx) && patt_lifetime.empty()) {
+    bool is_window_empty = true;
 
-  PtAssignment pt_assign;
-  pt_assign.configure(
-      pt_assign_engine_,
-      verbose_, endcap_, sector_, bx,
-      readPtLUTFile_, fixMode15HighPt_,
-      bug9BitDPhi_, bugMode7CLCT_, bugNegPt_,
-      bugGMTPhi_, promoteMode7_, modeQualVer_
-  );
-
-  std::map<int, TriggerPrimitiveCollection> selected_dt_map;
-  std::map<int, TriggerPrimitiveCollection> selected_csc_map;
-  std::map<int, TriggerPrimitiveCollection> selected_rpc_map;
-  std::map<int, TriggerPrimitiveCollection> selected_gem_map;
-  std::map<int, TriggerPrimitiveCollection> selected_me0_map;
-  std::map<int, TriggerPrimitiveCollection> selected_prim_map;
-  std::map<int, TriggerPrimitiveCollection> inclusive_selected_prim_map;
-
-  EMTFHitCollection conv_hits;  // "converted" hits converted by primitive converter
-  EMTFHitCollection inclusive_conv_hits;
-
-  emtf::zone_array<EMTFRoadCollection> zone_roads;  // each zone has its road collection
+    for (const auto& conv_hits : extended_conv_hits) {
+      if (!conv_hits.empty())
+        is_window_empty = false;
+    }
+    for (const auto& zone_tracks : extended_best_track_cands) {
+      for (const auto& tracks : zone_tracks) {
+        if (!tracks.empty())
+          is_window_empty = false;
+      }
+    }
 
-  emtf::zone_array<EMTFTrackCollection> zone_tracks;  // each zone has its track collection
+    if (is_window_empty) {
+      extended_conv_hits.push_back().clear();
+      for (auto& tracks : extended_best_track_cands.push_back())
+        tracks.clear();
+      return;
+    }
+  }
 
-  EMTFTrackCollection best_tracks;  // "best" tracks selected from all the zones
+  // The intermediate objects are members that keep their memory from the
+  // previous BXs and events, they are cleared here
+  PrimitiveLinkTable& selected_dt_map             = selected_dt_map_;
+  PrimitiveLinkTable& selected_csc_map            = selected_csc_map_;
+  PrimitiveLinkTable& selected_rpc_map            = selected_rpc_map_;
+  PrimitiveLinkTable& selected_gem_map            = selected_gem_map_;
+  PrimitiveLinkTable& selected_me0_map            = selected_me0_map_;
+  PrimitiveLinkTable& selected_prim_map           = selected_prim_map_;
+  PrimitiveLinkTable& inclusive_selected_prim_map = inclusive_selected_prim_map_;
+  selected_dt_map.clear();
+  selected_csc_map.clear();
+  selected_rpc_map.clear();
+  selected_gem_map.clear();
+  selected_me0_map.clear();
+  selected_prim_map.clear();
+  inclusive_selected_prim_map.clear();
+
+  EMTFHitCollection& conv_hits = extended_conv_hits.push_back();  // "converted" hits converted by primitive converter
+  conv_hits.clear();
+  EMTFHitCollection& inclusive_conv_hits = inclusive_conv_hits_;
+  inclusive_conv_hits.clear();
+
+  emtf::zone_array<EMTFRoadCollection>& zone_roads = zone_roads_;  // each zone has its road collection
+  for (auto& roads : zone_roads)
+    roads.clear();
+
+  emtf::zone_array<EMTFTrackCollection>& zone_tracks = extended_best_track_cands.push_back();  // each zone has its track collection
+  for (auto& tracks : zone_tracks)
+    tracks.clear();
+
+  EMTFTrackCollection& best_tracks = best_tracks_;  // "best" tracks selected from all the zones
+  best_tracks.clear();
 
   // ___________________________________________________________________________
   // Process
@@ -648,75 +715,71 @@ void SectorProcessor::process_single_bx(
   // Put them into maps with an index that roughly corresponds to
   // each input link.
   // From src/PrimitiveSelection.cc
-  prim_sel.process(DTTag(), muon_primitives, selected_dt_map);
-  prim_sel.process(CSCTag(), muon_primitives, selected_csc_map);
+  prim_sel_.process(DTTag(), bx, muon_primitives, prim_index, selected_dt_map);
+  prim_sel_.process(CSCTag(), bx, muon_primitives, prim_index, selected_csc_map);
   if (useRPC_) {
-    prim_sel.process(RPCTag(), muon_primitives, selected_rpc_map);
+    prim_sel_.process(RPCTag(), bx, muon_primitives, prim_index, selected_rpc_map);
   }
-  prim_sel.process(GEMTag(), muon_primitives, selected_gem_map);
-  prim_sel.process(ME0Tag(), muon_primitives, selected_me0_map);
-  prim_sel.merge(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, selected_prim_map);
+  prim_sel_.process(GEMTag(), bx, muon_primitives, prim_index, selected_gem_map);
+  prim_sel_.process(ME0Tag(), bx, muon_primitives, prim_index, selected_me0_map);
+  prim_sel_.merge(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, selected_prim_map);
+
+  // Keep all the selected primitives for the use of data-emulator comparisons.
+  // They include the extra ones that are not used in track building and the subsequent steps.
+  prim_sel_.merge_no_truncate(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, inclusive_selected_prim_map);
+
+  // Reset the per-BX tables for the next BX
+  selected_dt_map.clear();
+  selected_csc_map.clear();
+  selected_rpc_map.clear();
+  selected_gem_map.clear();
+  selected_me0_map.clear();
 
   // Convert trigger primitives into "converted" hits
   // A converted hit consists of integer representations of phi, theta, and zones
+  // The inclusive primitives are converted once, and the hits used in track building
+  // are taken from them
   // From src/PrimitiveConversion.cc
+  prim_conv_.process(inclusive_selected_prim_map, selected_prim_map, inclusive_conv_hits, conv_hits);
 #ifdef PHASE_TWO_TRIGGER
   // Exclude Phase 2 trigger primitives before running the rest of EMTF
-  prim_conv.process(selected_prim_map, conv_hits);
-  EMTFHitCollection tmp_conv_hits;
-  for (const auto& conv_hit : conv_hits) {
-    if (prim_conv.is_valid_for_run2(conv_hit)) {
-      tmp_conv_hits.push_back(conv_hit);
-    }
-  }
-  extended_conv_hits.push_back(tmp_conv_hits);
-#else
-  prim_conv.process(selected_prim_map, conv_hits);
-  extended_conv_hits.push_back(conv_hits);
+  conv_hits.erase(std::remove_if(conv_hits.begin(), conv_hits.end(), [this](const EMTFHit& conv_hit) {
+    return !prim_conv_.is_valid_for_run2(conv_hit);
+  }), conv_hits.end());
 #endif
 
-  {
-    // Keep all the converted hits for the use of data-emulator comparisons.
-    // They include the extra ones that are not used in track building and the subsequent steps.
-    prim_sel.merge_no_truncate(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, inclusive_selected_prim_map);
-    prim_conv.process(inclusive_selected_prim_map, inclusive_conv_hits);
-
-    // Clear the input maps to save memory
-    selected_dt_map.clear();
-    selected_csc_map.clear();
-    selected_rpc_map.clear();
-    selected_gem_map.clear();
-    selected_me0_map.clear();
-  }
+  // Organize the converted hits in the BX window by zone and (zone, station)
+  // for pattern recognition and primitive matching
+  // From src/ConvHitStore.cc
+  conv_hit_store.build(bx, extended_conv_hits);
 
   // Detect patterns in all zones, find 3 best roads in each zone
   // From src/PatternRecognition.cc
-  patt_recog.process(extended_conv_hits, patt_lifetime_map, zone_roads);
+  patt_recog_.process(bx, extended_conv_hits, conv_hit_store, patt_lifetime, zone_roads);
 
   // Match the trigger primitives to the roads, create tracks
   // From src/PrimitiveMatching.cc
-  prim_match.process(extended_conv_hits, zone_roads, zone_tracks);
+  prim_match_.process(bx, conv_hit_store, zone_roads, zone_tracks);
 
   // Calculate deflection angles for each track and fill track variables
   // From src/AngleCalculation.cc
-  angle_calc.process(zone_tracks);
-  extended_best_track_cands.insert(extended_best_track_cands.begin(), zone_tracks.begin(), zone_tracks.end());  // push_front
+  angle_calc_.process(bx, zone_tracks);
 
   // Select 3 "best" tracks from all the zones
   // From src/BestTrackSelection.cc
-  btrack_sel.process(extended_best_track_cands, best_tracks);
+  btrack_sel_.process(bx, extended_best_track_cands, best_tracks);
 
   // Insert single LCTs from station 1 as tracks
   // From src/SingleHitTracks.cc
 #ifdef PHASE_TWO_TRIGGER
   // Do not make single-hit tracks
 #else
-  single_hit.process(conv_hits, best_tracks);
+  single_hit_.process(bx, conv_hits, best_tracks);
 #endif
 
   // Construct pT address, assign pT, calculate other GMT quantities
   // From src/PtAssignment.cc
-  pt_assign.process(best_tracks);
+  pt_assign_.process(best_tracks);
 
   // ___________________________________________________________________________
   // Output
@@ -1,14 +1,13 @@
 #include "L1Trigger/L1TMuonEndCap/interface/SingleHitTrack.h"
 
 void SingleHitTrack::configure(
-    int verbose, int endcap, int sector, int bx,
+    int verbose, int endcap, int sector,
     int maxTracks,
     bool useSingleHits
 ) {
   verbose_ = verbose;
   endcap_  = endcap;
   sector_  = sector;
-  bx_      = bx;
 
   maxTracks_ = maxTracks;
 
@@ -16,6 +15,7 @@ void SingleHitTrack::configure(
 }
 
 void SingleHitTrack::process(
+    int bx,
     const EMTFHitCollection& conv_hits,
     EMTFTrackCollection& best_tracks
 ) const {
@@ -113,9 +113,9 @@ void SingleHitTrack::process(
       new_trk.set_mode_inv     ( 0 );
       new_trk.set_rank         ( 0b0100000 );  // Station 1 hit, straightness 0 (see "rank" in AngleCalculation.cc)
       new_trk.set_winner       ( maxTracks_ - 1 );  // Always set to the last / lowest track
-      new_trk.set_bx           ( bx_ );
-      new_trk.set_first_bx     ( bx_ );
-      new_trk.set_second_bx    ( bx_ );
+      new_trk.set_bx           ( bx );
+      new_trk.set_first_bx     ( bx );
+      new_trk.set_second_bx    ( bx );
       new_trk.set_zone         ( zone );
       new_trk.set_ph_num       ( conv_hits_it.Zone_hit() );
       new_trk.set_ph_q         ( 0b010000 );  // Original "quality_code" from PatternRecognition.cc
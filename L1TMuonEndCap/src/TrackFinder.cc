@@ -1,8 +1,11 @@
 #include "L1Trigger/L1TMuonEndCap/interface/TrackFinder.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+#include "tbb/parallel_for.h"
+
 #include "L1Trigger/L1TMuonEndCap/interface/EMTFSubsystemCollector.h"
 
 // Experimental features
@@ -15,7 +18,10 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
     condition_helper_(),
     sector_processor_lut_(),
     pt_assign_engine_(),
+    prim_index_(),
     sector_processors_(),
+    expt_sector_processors_(),
+    expt_context_(),
     config_(iConfig),
     tokenDTPhi_(iConsumes.consumes<DTTag::digi_collection>(iConfig.getParameter<edm::InputTag>("DTPhiInput"))),
     tokenDTTheta_(iConsumes.consumes<DTTag::theta_digi_collection>(iConfig.getParameter<edm::InputTag>("DTThetaInput"))),
@@ -36,6 +42,8 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
     useGEM_(iConfig.getParameter<bool>("GEMEnable")),
     useIRPC_(iConfig.getParameter<bool>("IRPCEnable")),
     useME0_(iConfig.getParameter<bool>("ME0Enable")),
+    parallelSectors_(iConfig.getParameter<bool>("ParallelSectors")),
+    phase2NativeNN_(iConfig.getParameter<bool>("Phase2NativeNN")),
     era_(iConfig.getParameter<std::string>("Era"))
 {
 
@@ -57,6 +65,8 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
   auto bxShiftRPC  = iConfig.getParameter<int>("RPCInputBXShift");
   auto bxShiftGEM  = iConfig.getParameter<int>("GEMInputBXShift");
 
+  auto fillSimCoords = iConfig.getParameter<bool>("FillSimCoordinates");
+
   const auto& spPCParams16 = config_.getParameter<edm::ParameterSet>("spPCParams16");
   auto zoneBoundaries     = spPCParams16.getParameter<std::vector<int> >("ZoneBoundaries");
   auto zoneOverlap        = spPCParams16.getParameter<int>("ZoneOverlap");
@@ -88,6 +98,8 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
 
   const auto& spPAParams16 = config_.getParameter<edm::ParameterSet>("spPAParams16");
   auto readPtLUTFile      = spPAParams16.getParameter<bool>("ReadPtLUTFile");
+  auto mmapPtLUTFile      = spPAParams16.getParameter<bool>("MmapPtLUTFile");
+  auto populatePtLUTFile  = spPAParams16.getParameter<bool>("PopulatePtLUTFile");
   auto fixMode15HighPt    = spPAParams16.getParameter<bool>("FixMode15HighPt");
   auto bug9BitDPhi        = spPAParams16.getParameter<bool>("Bug9BitDPhi");
   auto bugMode7CLCT       = spPAParams16.getParameter<bool>("BugMode7CLCT");
@@ -96,6 +108,12 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
   auto promoteMode7       = spPAParams16.getParameter<bool>("PromoteMode7");
   auto modeQualVer        = spPAParams16.getParameter<int>("ModeQualVer");
 
+  // Configure pT LUT reader, shared by all sector processors
+  pt_assign_engine_->configure_ptlut_reader(mmapPtLUTFile, populatePtLUTFile);
+
+  // Configure primitive index. It covers all the BXs processed by the sector processors.
+  prim_index_.configure(minBX, maxBX + bxWindow - 1, bxShiftCSC, bxShiftRPC, bxShiftGEM);
+
   // Configure sector processors
   for (int endcap = emtf::MIN_ENDCAP; endcap <= emtf::MAX_ENDCAP; ++endcap) {
     for (int sector = emtf::MIN_TRIGSECTOR; sector <= emtf::MAX_TRIGSECTOR; ++sector) {
@@ -110,7 +128,7 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
           minBX, maxBX, bxWindow, bxShiftCSC, bxShiftRPC, bxShiftGEM,
           era_,
           zoneBoundaries, zoneOverlap,
-          includeNeighbor, duplicateTheta, fixZonePhi, useNewZones, fixME11Edges,
+          includeNeighbor, duplicateTheta, fixZonePhi, useNewZones, fixME11Edges, fillSimCoords,
           pattDefinitions, symPattDefinitions, useSymPatterns,
           thetaWindow, thetaWindowZone0, useRPC_, useSingleHits, bugSt2PhDiff, bugME11Dupes, bugAmbigThetaWin, twoStationSameBX,
           maxRoadsPerZone, maxTracks, useSecondEarliest, bugSameSectorPt0,
@@ -119,6 +137,9 @@ TrackFinder::TrackFinder(const edm::ParameterSet& iConfig, edm::ConsumesCollecto
     }
   }
 
+  // Configure pT assignment engine, shared by all sector processors
+  sector_processors_.front().configure_pt_assign_engine();
+
 #ifdef PHASE_TWO_TRIGGER
   // This flag is defined in BuildFile.xml
   std::cout << "The EMTF emulator has been customized with flag PHASE_TWO_TRIGGER." << std::endl;
@@ -182,6 +203,30 @@ void TrackFinder::process(
     }
   }
 
+  // Run-dependent configure. This overwrites many of the configurables passed by the python config file.
+  // It is done before the primitives are bucketed, as it can widen the BX range of the sector processors.
+  if (era_ != "Phase2_timing" && iEvent.isRealData() && fwConfig_) {
+    for (auto& sp : sector_processors_) {
+      sp.configure_by_fw_version(condition_helper_.get_fw_version());
+    }
+    // The pT assignment engine is shared, so it is configured here and not
+    // by each sector processor, which can run in parallel
+    sector_processors_.front().configure_pt_assign_engine();
+  }
+
+  // Bucket the trigger primitives by subsystem, sector and BX. The index
+  // covers the BXs of all the sector processors.
+  {
+    int minBX = sector_processors_.front().get_min_prim_bx();
+    int maxBX = sector_processors_.front().get_max_prim_bx();
+    for (const auto& sp : sector_processors_) {
+      minBX = std::min(minBX, sp.get_min_prim_bx());
+      maxBX = std::max(maxBX, sp.get_max_prim_bx());
+    }
+    prim_index_.set_bx_range(minBX, maxBX);
+  }
+  prim_index_.build(muon_primitives);
+
   // ___________________________________________________________________________
   // Run each sector processor
 
@@ -192,59 +237,125 @@ void TrackFinder::process(
   pt_assign_engine_->load(condition_helper_.get_pt_lut_version(), &(condition_helper_.getForest()));
 
   if (era_ == "Phase2_timing") {
-    for (int endcap = emtf::MIN_ENDCAP; endcap <= emtf::MAX_ENDCAP; ++endcap) {
-      for (int sector = emtf::MIN_TRIGSECTOR; sector <= emtf::MAX_TRIGSECTOR; ++sector) {
-        auto minBX      = config_.getParameter<int>("MinBX");
-        auto maxBX      = config_.getParameter<int>("MaxBX");
-        auto bxWindow   = config_.getParameter<int>("BXWindow");
-        auto bxShiftCSC = config_.getParameter<int>("CSCInputBXShift");
-        auto bxShiftRPC = config_.getParameter<int>("RPCInputBXShift");
-        auto bxShiftGEM = config_.getParameter<int>("GEMInputBXShift");
-        int delayBX   = bxWindow - 1;
-        // For now, only consider BX=0
-        minBX = 0;
-        maxBX = 0;
-        delayBX = 0;
-
-        experimental::Phase2SectorProcessor expt_sp;
-        for (int bx = minBX; bx <= maxBX + delayBX; ++bx) {
-          expt_sp.configure(
+    auto minBX      = config_.getParameter<int>("MinBX");
+    auto maxBX      = config_.getParameter<int>("MaxBX");
+    auto bxWindow   = config_.getParameter<int>("BXWindow");
+    auto bxShiftCSC = config_.getParameter<int>("CSCInputBXShift");
+    auto bxShiftRPC = config_.getParameter<int>("RPCInputBXShift");
+    auto bxShiftGEM = config_.getParameter<int>("GEMInputBXShift");
+    int delayBX   = bxWindow - 1;
+    // For now, only consider BX=0
+    minBX = 0;
+    maxBX = 0;
+    delayBX = 0;
+
+    // All the state of the Phase 2 sector processors is owned by this
+    // TrackFinder, so the sectors can run concurrently, as for the current EMTF
+    const bool parallel = (parallelSectors_ && verbose_ == 0);
+
+    for (int bx = minBX; bx <= maxBX + delayBX; ++bx) {
+      for (int endcap = emtf::MIN_ENDCAP; endcap <= emtf::MAX_ENDCAP; ++endcap) {
+        for (int sector = emtf::MIN_TRIGSECTOR; sector <= emtf::MAX_TRIGSECTOR; ++sector) {
+          const int es = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+
+          expt_sector_processors_.at(es).configure(
             &geometry_translator_,
             &condition_helper_,
             &sector_processor_lut_,
             pt_assign_engine_.get(),
+            &expt_context_,
             verbose_, endcap, sector, bx,
             bxShiftCSC, bxShiftRPC, bxShiftGEM,
             era_
           );
-          expt_sp.process(
+        }
+      }
+
+      // Build the roads in every sector
+      if (parallel) {
+        tbb::parallel_for(0, emtf::NUM_SECTORS, [&](int es) {
+          expt_sector_processors_.at(es).process_roads(
             iEvent, iSetup,
             muon_primitives,
-            out_hits,
-            out_tracks
+            prim_index_
+          );
+        });
+      } else {
+        for (int es = 0; es < emtf::NUM_SECTORS; ++es) {
+          expt_sector_processors_.at(es).process_roads(
+            iEvent, iSetup,
+            muon_primitives,
+            prim_index_
           );
         }
       }
+
+      // Assign pT to the roads of all the sectors at once
+      experimental::Phase2SectorProcessor::assign_pt(expt_sector_processors_, expt_context_, phase2NativeNN_);
+
+      // Build the tracks in every sector
+      if (parallel) {
+        tbb::parallel_for(0, emtf::NUM_SECTORS, [&](int es) {
+          expt_sector_processors_.at(es).process_tracks();
+        });
+      } else {
+        for (int es = 0; es < emtf::NUM_SECTORS; ++es) {
+          expt_sector_processors_.at(es).process_tracks();
+        }
+      }
+
+      // Remove the ghosts among the tracks of all the sectors at once
+      experimental::Phase2SectorProcessor::remove_ghosts(expt_sector_processors_, expt_context_);
+
+      // Output the hits and the tracks in endcap/sector order
+      for (int es = 0; es < emtf::NUM_SECTORS; ++es) {
+        expt_sector_processors_.at(es).process_output(
+          out_hits,
+          out_tracks
+        );
+      }
     }
   }  // era_ == "Phase2_timing"
 
   else {  // era_ != "Phase2_timing"
-    for (int endcap = emtf::MIN_ENDCAP; endcap <= emtf::MAX_ENDCAP; ++endcap) {
-      for (int sector = emtf::MIN_TRIGSECTOR; sector <= emtf::MAX_TRIGSECTOR; ++sector) {
-        const int es = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+    if (parallelSectors_ && verbose_ == 0) {
+      // Each sector writes into its own buffers, which are merged afterwards in
+      // endcap/sector order so that the output is identical to the serial loop.
+      // The debug printouts are not thread-safe, so verbose mode always runs serially.
+      emtf::sector_array<EMTFHitCollection> sector_hits;
+      emtf::sector_array<EMTFTrackCollection> sector_tracks;
 
-        // Run-dependent configure. This overwrites many of the configurables passed by the python config file.
-        if (iEvent.isRealData() && fwConfig_) {
-          sector_processors_.at(es).configure_by_fw_version(condition_helper_.get_fw_version());
-        }
+      const auto ievent = iEvent.id().event();
 
-        // Process
+      tbb::parallel_for(0, emtf::NUM_SECTORS, [&](int es) {
         sector_processors_.at(es).process(
-            iEvent.id().event(),
+            ievent,
             muon_primitives,
-            out_hits,
-            out_tracks
+            prim_index_,
+            sector_hits.at(es),
+            sector_tracks.at(es)
         );
+      });
+
+      for (int es = 0; es < emtf::NUM_SECTORS; ++es) {
+        out_hits.insert(out_hits.end(), sector_hits.at(es).begin(), sector_hits.at(es).end());
+        out_tracks.insert(out_tracks.end(), sector_tracks.at(es).begin(), sector_tracks.at(es).end());
+      }
+
+    } else {
+      for (int endcap = emtf::MIN_ENDCAP; endcap <= emtf::MAX_ENDCAP; ++endcap) {
+        for (int sector = emtf::MIN_TRIGSECTOR; sector <= emtf::MAX_TRIGSECTOR; ++sector) {
+          const int es = (endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (sector - emtf::MIN_TRIGSECTOR);
+
+          // Process
+          sector_processors_.at(es).process(
+              iEvent.id().event(),
+              muon_primitives,
+              prim_index_,
+              out_hits,
+              out_tracks
+          );
+        }
       }
     }
   }  // era_ != "Phase2_timing"
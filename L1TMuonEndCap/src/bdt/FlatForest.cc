@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////////
+//                            FlatForest.cxx                            //
+// =====================================================================//
+// This is the inference-only version of a forest of decision trees.    //
+// The trees of a Forest are copied into one contiguous node array so   //
+// they can be evaluated without Events and without chasing pointers.   //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////
+// _______________________Includes_______________________________________//
+///////////////////////////////////////////////////////////////////////////
+
+#include "L1Trigger/L1TMuonEndCap/interface/bdt/FlatForest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace emtf;
+
+//////////////////////////////////////////////////////////////////////////
+// _______________________Constructor(s)________________________________//
+//////////////////////////////////////////////////////////////////////////
+
+FlatForest::FlatForest()
+{
+    boostWeight = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+FlatForest::~FlatForest()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ______________________Compilation___________________________________//
+//////////////////////////////////////////////////////////////////////////
+
+void FlatForest::clear()
+{
+    nodes.clear();
+    leafValues.clear();
+    roots.clear();
+    boostWeight = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+void FlatForest::compile(Forest& forest, unsigned int numtrees)
+{
+// Copy the first numtrees trees of the forest into the flat node array.
+
+    clear();
+
+    if(numtrees > forest.size()) numtrees = forest.size();
+    if(numtrees == 0) return;
+
+    boostWeight = forest.getTree(0)->getBoostWeight();
+
+    roots.reserve(numtrees);
+    for(unsigned int i=0; i < numtrees; i++)
+    {
+        roots.push_back(compileRecursive(forest.getTree(i)->getRootNode()));
+    }
+
+    nodes.shrink_to_fit();
+    leafValues.shrink_to_fit();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+static_assert(sizeof(FlatForest::FlatNode) == 3*sizeof(int), "FlatNode must be three packed ints");
+
+unsigned int FlatForest::compileRecursive(Node* node)
+{
+// Append the node and its daughters in pre-order, return the node index.
+
+    unsigned int index = nodes.size();
+    nodes.push_back(FlatNode());
+
+    // Same terminal condition as Node::filterEventToDaughter
+    if(node->getLeftDaughter() == nullptr || node->getRightDaughter() == nullptr)
+    {
+        nodes[index].splitVariable = -1;
+        nodes[index].splitValue = 0;
+        nodes[index].next = leafValues.size();
+        leafValues.push_back(node->getFitValue());
+        return index;
+    }
+
+    // The features are integers, so (x < splitValue) is (x < ceil(splitValue))
+    double sp = std::ceil(node->getSplitValue());
+    if(sp > std::numeric_limits<int>::max()) sp = std::numeric_limits<int>::max();
+    if(sp < std::numeric_limits<int>::min()) sp = std::numeric_limits<int>::min();
+
+    nodes[index].splitVariable = node->getSplitVariable();
+    nodes[index].splitValue = static_cast<int>(sp);
+
+    compileRecursive(node->getLeftDaughter());  // lands at index+1
+    unsigned int right = compileRecursive(node->getRightDaughter());
+    nodes[index].next = right;
+    return index;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ______________________Prediction____________________________________//
+//////////////////////////////////////////////////////////////////////////
+
+double FlatForest::predict(const int* features) const
+{
+// Sum of the terminal node fit values over all trees, starting from the
+// boost weight of the first tree, as in Forest::predictEvent.
+
+    const FlatNode* n = nodes.data();
+    double predictedValue = boostWeight;
+
+    for(unsigned int root : roots)
+    {
+        unsigned int i = root;
+        while(n[i].splitVariable >= 0)
+        {
+            i = (features[n[i].splitVariable] < n[i].splitValue) ? i+1 : n[i].next;
+        }
+        predictedValue += leafValues[n[i].next];
+    }
+    return predictedValue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+void FlatForest::predictBatch(const int* features, unsigned int stride, unsigned int n, double* predictedValues) const
+{
+// Predict n events at once. Every event sees the trees in the same order
+// as in predict(), so the results are identical, only the loops are swapped.
+
+    // Small enough that the rows and the current tree stay in L1
+    const unsigned int blockSize = 64;
+
+    unsigned int i = 0;
+
+#if defined(__AVX2__)
+    for(; i+8 <= n; i += 8)
+    {
+        predictBlock8(features + i*stride, stride, predictedValues + i);
+    }
+#endif
+
+    for(; i < n; i += blockSize)
+    {
+        unsigned int m = std::min(blockSize, n-i);
+        predictBlock(features + i*stride, stride, m, predictedValues + i);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+void FlatForest::predictBlock(const int* features, unsigned int stride, unsigned int n, double* predictedValues) const
+{
+    const FlatNode* nd = nodes.data();
+
+    for(unsigned int k=0; k < n; k++) predictedValues[k] = boostWeight;
+
+    for(unsigned int root : roots)
+    {
+        for(unsigned int k=0; k < n; k++)
+        {
+            const int* x = features + k*stride;
+            unsigned int i = root;
+            while(nd[i].splitVariable >= 0)
+            {
+                i = (x[nd[i].splitVariable] < nd[i].splitValue) ? i+1 : nd[i].next;
+            }
+            predictedValues[k] += leafValues[nd[i].next];
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(__AVX2__)
+void FlatForest::predictBlock8(const int* features, unsigned int stride, double* predictedValues) const
+{
+// Walk each tree for 8 events in lock step. The node fields are gathered
+// per lane, lanes that already reached a terminal node are masked off,
+// and the leaf values are accumulated in two 4 x double registers.
+
+    const int* nd = reinterpret_cast<const int*>(nodes.data());
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    const __m256i lane = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+
+    __m256d sumLo = _mm256_set1_pd(boostWeight);
+    __m256d sumHi = _mm256_set1_pd(boostWeight);
+
+    for(unsigned int root : roots)
+    {
+        __m256i idx = _mm256_set1_epi32(root);
+        __m256i off = _mm256_add_epi32(idx, _mm256_add_epi32(idx, idx));
+
+        while(true)
+        {
+            __m256i var = _mm256_i32gather_epi32(nd, off, 4);
+            __m256i active = _mm256_cmpgt_epi32(var, _mm256_set1_epi32(-1));
+            if(_mm256_testz_si256(active, active)) break;
+
+            __m256i cut = _mm256_mask_i32gather_epi32(zero, nd+1, off, active, 4);
+            __m256i right = _mm256_mask_i32gather_epi32(zero, nd+2, off, active, 4);
+            __m256i x = _mm256_mask_i32gather_epi32(zero, features, _mm256_add_epi32(lane, var), active, 4);
+
+            __m256i goLeft = _mm256_cmpgt_epi32(cut, x);
+            __m256i child = _mm256_blendv_epi8(right, _mm256_add_epi32(idx, one), goLeft);
+            idx = _mm256_blendv_epi8(idx, child, active);
+            off = _mm256_add_epi32(idx, _mm256_add_epi32(idx, idx));
+        }
+
+        __m256i leaf = _mm256_i32gather_epi32(nd+2, off, 4);
+        __m256d fitLo = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), leafValues.data(), _mm256_castsi256_si128(leaf), all, 8);
+        __m256d fitHi = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), leafValues.data(), _mm256_extracti128_si256(leaf, 1), all, 8);
+        sumLo = _mm256_add_pd(sumLo, fitLo);
+        sumHi = _mm256_add_pd(sumHi, fitHi);
+    }
+
+    _mm256_storeu_pd(predictedValues, sumLo);
+    _mm256_storeu_pd(predictedValues+4, sumHi);
+}
+#else
+void FlatForest::predictBlock8(const int* features, unsigned int stride, double* predictedValues) const
+{
+    predictBlock(features, stride, 8, predictedValues);
+}
+#endif
@@ -8,7 +8,10 @@
 // v Rafael added
 #include <fstream>
 
-#define PR_IO_FILE
+// Write the hits and roads of the pattern recognition to pattrec.csv. The file
+// belongs to the Phase2Context, so run with one stream and without
+// ParallelSectors when it is enabled.
+//#define PR_IO_FILE
 // ^
 
 // _____________________________________________________________________________
@@ -26,6 +29,7 @@ void Phase2SectorProcessor::configure(
     const ConditionHelper* cond,
     const SectorProcessorLUT* lut,
     PtAssignmentEngine* pt_assign_engine,
+    Phase2Context* context,
     // Sector processor config
     int verbose, int endcap, int sector, int bx,
     int bxShiftCSC, int bxShiftRPC, int bxShiftGEM,
@@ -38,11 +42,13 @@ void Phase2SectorProcessor::configure(
   assert(cond != nullptr);
   assert(lut  != nullptr);
   assert(pt_assign_engine != nullptr);
+  assert(context != nullptr);
 
   geom_             = geom;
   cond_             = cond;
   lut_              = lut;
   pt_assign_engine_ = pt_assign_engine;
+  context_          = context;
 
   verbose_    = verbose;
   endcap_     = endcap;
@@ -54,16 +60,6 @@ void Phase2SectorProcessor::configure(
   bxShiftGEM_ = bxShiftGEM;
 
   era_        = era;
-}
-
-void Phase2SectorProcessor::process(
-    // Input
-    const edm::Event& iEvent, const edm::EventSetup& iSetup,
-    const TriggerPrimitiveCollection& muon_primitives,
-    // Output
-    EMTFHitCollection& out_hits,
-    EMTFTrackCollection& out_tracks
-) const {
 
   // ___________________________________________________________________________
   // Primitive selection & primitive conversion
@@ -79,71 +75,92 @@ void Phase2SectorProcessor::process(
   bool useNewZones      = false;
   bool fixME11Edges     = true;
 
-  PrimitiveSelection prim_sel;
-  prim_sel.configure(
-      verbose_, endcap_, sector_, bx_,
+  prim_sel_.configure(
+      verbose_, endcap_, sector_,
       bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
       includeNeighbor, duplicateTheta,
       bugME11Dupes
   );
 
-  PrimitiveConversion prim_conv;
-  prim_conv.configure(
+  prim_conv_.configure(
       geom_, lut_,
-      verbose_, endcap_, sector_, bx_,
+      verbose_, endcap_, sector_,
       bxShiftCSC_, bxShiftRPC_, bxShiftGEM_,
       zoneBoundaries, zoneOverlap,
       duplicateTheta, fixZonePhi, useNewZones, fixME11Edges,
-      bugME11Dupes
+      bugME11Dupes, true
   );
+}
+
+void Phase2SectorProcessor::process_roads(
+    // Input
+    const edm::Event& iEvent, const edm::EventSetup& iSetup,
+    const TriggerPrimitiveCollection& muon_primitives,
+    const EMTFPrimitiveIndex& prim_index
+) {
 
   // ___________________________________________________________________________
   // Input
 
-  EMTFHitCollection conv_hits;     // "converted" hits converted by primitive converter
-  std::vector<Track> best_tracks;  // "best" tracks selected from all the zones. 'Track' is an internal class
-
-  std::map<int, TriggerPrimitiveCollection> selected_dt_map;
-  std::map<int, TriggerPrimitiveCollection> selected_csc_map;
-  std::map<int, TriggerPrimitiveCollection> selected_rpc_map;
-  std::map<int, TriggerPrimitiveCollection> selected_gem_map;
-  std::map<int, TriggerPrimitiveCollection> selected_me0_map;
-  std::map<int, TriggerPrimitiveCollection> selected_prim_map;
-  std::map<int, TriggerPrimitiveCollection> inclusive_selected_prim_map;
+  EMTFHitCollection& conv_hits = conv_hits_;  // "converted" hits converted by primitive converter
+  conv_hits.clear();
+
+  PrimitiveLinkTable& selected_dt_map   = selected_dt_map_;
+  PrimitiveLinkTable& selected_csc_map  = selected_csc_map_;
+  PrimitiveLinkTable& selected_rpc_map  = selected_rpc_map_;
+  PrimitiveLinkTable& selected_gem_map  = selected_gem_map_;
+  PrimitiveLinkTable& selected_me0_map  = selected_me0_map_;
+  PrimitiveLinkTable& selected_prim_map = selected_prim_map_;
+  selected_dt_map.clear();
+  selected_csc_map.clear();
+  selected_rpc_map.clear();
+  selected_gem_map.clear();
+  selected_me0_map.clear();
+  selected_prim_map.clear();
 
   // Select muon primitives that belong to this sector and this BX.
   // Put them into maps with an index that roughly corresponds to
   // each input link.
-  prim_sel.process(DTTag(), muon_primitives, selected_dt_map);
-  prim_sel.process(CSCTag(), muon_primitives, selected_csc_map);
-  prim_sel.process(RPCTag(), muon_primitives, selected_rpc_map);
-  prim_sel.process(GEMTag(), muon_primitives, selected_gem_map);
-  prim_sel.process(ME0Tag(), muon_primitives, selected_me0_map);
-  prim_sel.merge_no_truncate(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, selected_prim_map);
+  prim_sel_.process(DTTag(), bx_, muon_primitives, prim_index, selected_dt_map);
+  prim_sel_.process(CSCTag(), bx_, muon_primitives, prim_index, selected_csc_map);
+  prim_sel_.process(RPCTag(), bx_, muon_primitives, prim_index, selected_rpc_map);
+  prim_sel_.process(GEMTag(), bx_, muon_primitives, prim_index, selected_gem_map);
+  prim_sel_.process(ME0Tag(), bx_, muon_primitives, prim_index, selected_me0_map);
+  prim_sel_.merge_no_truncate(selected_dt_map, selected_csc_map, selected_rpc_map, selected_gem_map, selected_me0_map, selected_prim_map);
 
   // Convert trigger primitives into "converted" hits
   // A converted hit consists of integer representations of phi, theta, and zones
-  prim_conv.process(selected_prim_map, conv_hits);
+  prim_conv_.process(selected_prim_map, conv_hits);
 
-  {
-    // Clear the input maps to save memory
-    selected_dt_map.clear();
-    selected_csc_map.clear();
-    selected_rpc_map.clear();
-    selected_gem_map.clear();
-    selected_me0_map.clear();
-  }
+  // ___________________________________________________________________________
+  // Build
+
+  build_roads(conv_hits);
+  return;
+}
+
+void Phase2SectorProcessor::process_tracks() {
 
   // ___________________________________________________________________________
   // Build
 
-  build_tracks(conv_hits, best_tracks);
+  best_tracks_.clear();
+  build_tracks(best_tracks_);
+  return;
+}
+
+void Phase2SectorProcessor::process_output(
+    // Output
+    EMTFHitCollection& out_hits,
+    EMTFTrackCollection& out_tracks
+) {
+  const EMTFHitCollection& conv_hits = conv_hits_;
 
   // ___________________________________________________________________________
   // Output
 
   EMTFTrackCollection best_emtf_tracks;
-  convert_tracks(conv_hits, best_tracks, best_emtf_tracks);
+  convert_tracks(conv_hits, best_tracks_, best_emtf_tracks);
 
   out_hits.insert(out_hits.end(), conv_hits.begin(), conv_hits.end());
   out_tracks.insert(out_tracks.end(), best_emtf_tracks.begin(), best_emtf_tracks.end());
@@ -854,6 +871,10 @@ public:
 
 constexpr PatternBank bank;
 
+#include "patterngrid.icc"
+
+constexpr PatternGrid grid;
+
 
 // _____________________________________________________________________________
 // PatternRecognition class matches hits to pre-defined patterns.
@@ -870,16 +891,10 @@ constexpr PatternBank bank;
 class PatternRecognition {
 public:
   void run(int32_t endcap, int32_t sector, const EMTFHitCollection& conv_hits,
-           std::vector<Hit>& sector_hits, std::vector<Road>& sector_roads) const {
+           std::vector<Hit>& sector_hits, std::vector<Road>& sector_roads,
+           Phase2PatternBuffers& buffers, std::ofstream& pfile) const {
 #ifdef PR_IO_FILE
-    static bool first = 1;
-    static std::ofstream pfile("pattrec.csv"); // Overwrite existing file
     assert(pfile.is_open());
-    if (first) { // Add header only first time
-        pfile << std::setw(8);
-        pfile << "name,st,ph,th," << std::endl;
-        first = 0;
-    }
 #endif /* PR_IO_FILE */
 
     // Optimize for CPU processing?
@@ -936,17 +951,12 @@ public:
     }
 
     // Apply patterns to the sector hits
-    if (optimize_for_cpu) {
-      apply_patterns(endcap, sector, sector_hits, sector_roads);
-    } else {
-      apply_patterns_unoptimized(endcap, sector, sector_hits, sector_roads);
-    }
+    // The roads are created already sorted according to the road_id
+    apply_patterns(endcap, sector, sector_hits, sector_roads, buffers);
 
-    // Sort the roads according to the road_id
-    constexpr auto sort_roads_f = [](const Road& lhs, const Road& rhs) {
+    assert(std::is_sorted(sector_roads.begin(), sector_roads.end(), [](const Road& lhs, const Road& rhs) {
       return lhs.id() < rhs.id();
-    };
-    std::sort(sector_roads.begin(), sector_roads.end(), sort_roads_f);
+    }));
 #ifdef PR_IO_FILE
     for (
         std::vector<Road>::const_iterator itr = sector_roads.begin(), end = sector_roads.end();
@@ -1086,134 +1096,13 @@ private:
     return;
   }
 
-  void apply_patterns_in_zone(int32_t hit_zone, int32_t hit_lay,
-                              std::vector<std::pair<int32_t, int32_t> >& result) const {
-    result.clear();
-
-    // Given zone & lay & quadstrip, only have to check against straightness
-    //const auto& patterns_x0 = bank.x_array[hit_lay][hit_zone][0];
-    //const auto& patterns_x1 = bank.x_array[hit_lay][hit_zone][2];
-    //assert(patterns_x0.size() == patterns_x1.size());
-
-    auto x0_iter = bank.x_array[hit_lay][hit_zone][0].begin();  // zero-copy op when using the iterators
-    auto x0_end  = bank.x_array[hit_lay][hit_zone][0].end();
-    auto x1_iter = bank.x_array[hit_lay][hit_zone][2].begin();
-    auto x1_end  = bank.x_array[hit_lay][hit_zone][2].end();
-
-    int32_t ipt  = 0;
-    int32_t iphi = 0;
-    for (; (x0_iter != x0_end) && (x1_iter != x1_end); ++x0_iter, ++x1_iter) {
-      auto x0 = (*x0_iter);
-      auto x1 = (*x1_iter);
-      for (iphi = x0; iphi != (x1+1); ++iphi) {
-        result.emplace_back(ipt, iphi);
-      }
-      ++ipt;
-    }
-    return;
-  }
-
   void apply_patterns(int32_t endcap, int32_t sector,
-                      const std::vector<Hit>& sector_hits, std::vector<Road>& sector_roads) const {
-
-    // Create a map of road_id -> road_hits
-    std::unordered_map<Road::road_id_t, Road::road_hits_t, Road::Hasher> amap;
-
-    // Stores the results from pattern recognition (pairs of (ipt, iphi)-indices).
-    std::vector<std::pair<int32_t, int32_t> > result;
-
-    // Loop over hits
-    for (const auto& hit : sector_hits) {
-      int32_t hit_lay = hit.emtf_layer;
-      int32_t hit_x   = util.find_pattern_x(hit.emtf_phi);
-      const auto& hit_zones = util.find_emtf_zones(hit);
-
-      // Loop over the zones that the hit is belong to
-      for (const auto& hit_zone : hit_zones) {
-        if (hit_zone == 6) {  // For now, ignore zone 6
-          continue;
-        }
-
-        // Pattern recognition
-        apply_patterns_in_zone(hit_zone, hit_lay, result);
-
-        // Loop over the results from pattern recognition
-        for (const auto& index : result) {
-          int32_t ipt  = index.first;
-          int32_t iphi = index.second;
-          iphi         = (hit_x - iphi);
-          int32_t ieta = hit_zone;
-
-          // 'x' is the unit used in the patterns
-          // Full range is 0 <= iphi <= 154. but a reduced range is sufficient (27% saving on patterns)
-          if ((PATTERN_X_SEARCH_MIN <= iphi) && (iphi <= PATTERN_X_SEARCH_MAX)) {
-            Road::road_id_t road_id {{endcap, sector, ipt, ieta, iphi}};
-            amap[road_id].push_back(hit);
-          }
-        }
-      }  // end loop over hit_zones
-    }  // end loop over sector_hits
-
-    // Create roads
-    for (const auto& kv : amap) {
-      const Road::road_id_t&   road_id   = kv.first;
-      const Road::road_hits_t& road_hits = kv.second;
-      create_road(road_id, road_hits, sector_roads);  // only valid roads are being appended to sector_roads
-    }
-    return;
-  }
-
-  void apply_patterns_unoptimized(int32_t endcap, int32_t sector,
-                                  const std::vector<Hit>& sector_hits, std::vector<Road>& sector_roads) const {
-
-    // Loop over all zones
-    for (int32_t ieta = 0; ieta != PATTERN_BANK_NETA; ++ieta) {
-      if (ieta == 6) {  // For now, ignore zone 6
-        continue;
-      }
-
-      // Loop over all hits, find the ones that belong to this station and this zone
-      std::vector<Hit> zone_hits;
-      for (const auto& hit : sector_hits) {
-        //int32_t hit_lay = hit.emtf_layer;
-        //int32_t hit_x   = util.find_pattern_x(hit.emtf_phi);
-        const auto& hit_zones = util.find_emtf_zones(hit);
-
-        for (const auto& hit_zone : hit_zones) {
-          if (hit_zone == ieta) {
-            zone_hits.push_back(hit);
-          }
-        }  // end loop over hit_zones
-      }  // end loop over sector_hits
-
-      // Now loop over all the different shapes (straightness)
-      for (int32_t ipt = 0; ipt != PATTERN_BANK_NPT; ++ipt) {
-
-        // 'x' is the unit used in the patterns
-        // Full range is 0 <= iphi <= 154. but a reduced range is sufficient (27% saving on patterns)
-        for (int32_t iphi = PATTERN_X_SEARCH_MIN; iphi != (PATTERN_X_SEARCH_MAX+1); ++iphi) {
-          Road::road_id_t road_id {{endcap, sector, ipt, ieta, iphi}};
-          Road::road_hits_t road_hits;
-
-          for (const auto& hit : zone_hits) {
-            int32_t hit_lay = hit.emtf_layer;
-            int32_t hit_x   = util.find_pattern_x(hit.emtf_phi);
-
-            int32_t iphi_low  = bank.x_array[hit_lay][ieta][0][ipt];
-            int32_t iphi_high = bank.x_array[hit_lay][ieta][2][ipt];
-
-            if ((iphi + iphi_low <= hit_x) && (hit_x <= iphi + iphi_high)) {
-              road_hits.push_back(hit);
-            }
-          }
-
-          if (!road_hits.empty()) {
-            create_road(road_id, road_hits, sector_roads);  // only valid roads are being appended to sector_roads
-          }
-        }  // end loop over x
-      }  // end loop over all the different shapes (straightness)
-    }  // end loop over all zones
-
+                      const std::vector<Hit>& sector_hits, std::vector<Road>& sector_roads,
+                      Phase2PatternBuffers& buffers) const {
+    // only valid roads are being appended to sector_roads
+    grid.run(endcap, sector, sector_hits, buffers, [&](const Road::road_id_t& road_id, const Road::road_hits_t& road_hits) {
+      create_road(road_id, road_hits, sector_roads);
+    });
     return;
   }
 };
@@ -1526,11 +1415,13 @@ public:
   }
 };
 
+#include "ptnn.icc"
+
 // PtAssignment class assigns 2 parameters: pT and PU discr
 // Currently we take 36 variables for each road, send them to the NN (by
-// calling Tensorflow lib) and get the 2 parameters. The NN is stored in a
-// Tensorflow 'protobuf' file. The outputs of this class are the input and
-// output of the NN.
+// calling Tensorflow lib, or the native PtNN) and get the 2 parameters. The
+// NN is stored in a Tensorflow 'protobuf' file. The outputs of this class are
+// the input and output of the NN.
 
 class PtAssignment {
 public:
@@ -1561,6 +1452,7 @@ public:
     pbFileName = other.pbFileName;
     inputName = other.inputName;
     outputNames = other.outputNames;
+    nativeNN = other.nativeNN;
   }
 
   // Copy assignment
@@ -1571,43 +1463,51 @@ public:
       pbFileName = other.pbFileName;
       inputName = other.inputName;
       outputNames = other.outputNames;
+      nativeNN = other.nativeNN;
     }
     return *this;
   }
 
-  void run(const std::vector<Road>& slim_roads,
-           std::vector<Feature>& features, std::vector<Prediction>& predictions) const {
+  // Append the NN inputs of every road, one row of NFEATURES values per road
+  void run(const std::vector<Road>& slim_roads, std::vector<float>& features) const {
 
     // Loop over roads
     for (const auto& road : slim_roads) {
       Feature feature;
-      Prediction prediction;
       feature.fill(0);
-      prediction.fill(0);
 
-      predict(road, feature, prediction);
-      features.push_back(feature);
-      predictions.push_back(prediction);
+      preprocessing(road, feature);
+      features.insert(features.end(), feature.begin(), feature.end());
     }  // end loop over slim_roads
 
-    assert(slim_roads.size() == features.size());
-    assert(slim_roads.size() == predictions.size());
+    assert(slim_roads.size() * NFEATURES == features.size());
     return;
   }
 
-  void predict(const Road& road, Feature& feature, Prediction& prediction) const {
-    preprocessing(road, feature);
-    call_tensorflow(feature, prediction);
+  // Evaluate the NN once for all the rows of NN inputs, one row of
+  // NPREDICTIONS values per road
+  void predict(const std::vector<float>& features, std::vector<float>& predictions, bool use_native) const {
+    assert(features.size() % NFEATURES == 0);
+    predictions.clear();
+    predictions.resize(features.size() / NFEATURES * NPREDICTIONS, 0.);
+
+    if (!features.empty()) {
+      if (use_native) {
+        call_native(features, predictions);
+      } else {
+        call_tensorflow(features, predictions);
+      }
+    }
     return;
   }
 
 private:
   void preprocessing(const Road& road, Feature& feature) const {
-    static std::array<float, NLAYERS> x_phi;   // delta-phis = (raw phis - road_phi_median)
-    static std::array<float, NLAYERS> x_theta; // raw thetas
-    static std::array<float, NLAYERS> x_bend;
-    static std::array<float, NLAYERS> x_qual;
-    static std::array<float, NLAYERS> x_time;
+    std::array<float, NLAYERS> x_phi;   // delta-phis = (raw phis - road_phi_median)
+    std::array<float, NLAYERS> x_theta; // raw thetas
+    std::array<float, NLAYERS> x_bend;
+    std::array<float, NLAYERS> x_qual;
+    std::array<float, NLAYERS> x_time;
 
     // Initialize to zeros
     x_phi.fill(0);
@@ -1644,20 +1544,39 @@ private:
     return;
   }
 
-  void call_tensorflow(const Feature& feature, Prediction& prediction) const {
-    static tensorflow::Tensor input(tensorflow::DT_FLOAT, { 1, NFEATURES });
-    static std::vector<tensorflow::Tensor> outputs;
-    assert(feature.size() == NFEATURES);
+  void call_tensorflow(const std::vector<float>& features, std::vector<float>& predictions) const {
+    // The rows are evaluated independently, in a single call with a batch of N rows.
+    // The outputs can differ in the last bits from a batch of 1 row, see assign_pt().
+    const int n = features.size() / NFEATURES;
+    tensorflow::Tensor input(tensorflow::DT_FLOAT, { n, NFEATURES });
+    std::vector<tensorflow::Tensor> outputs;
 
     float* d = input.flat<float>().data();
-    std::copy(feature.begin(), feature.end(), d);
+    std::copy(features.begin(), features.end(), d);
     tensorflow::run(session, { { inputName, input } }, outputNames, &outputs);
     assert(outputs.size() == NPREDICTIONS);
-    assert(prediction.size() == NPREDICTIONS);
+    assert(predictions.size() == (size_t) n * NPREDICTIONS);
 
     const float reg_pt_scale = 100.;  // a scale factor applied to regression during training
-    prediction.at(0) = outputs[0].matrix<float>()(0, 0) / reg_pt_scale; // q/pT
-    prediction.at(1) = outputs[1].matrix<float>()(0, 0); // PU discr
+    for (int i = 0; i < n; ++i) {
+      predictions.at(i * NPREDICTIONS + 0) = outputs[0].matrix<float>()(i, 0) / reg_pt_scale; // q/pT
+      predictions.at(i * NPREDICTIONS + 1) = outputs[1].matrix<float>()(i, 0); // PU discr
+    }
+    return;
+  }
+
+  void call_native(const std::vector<float>& features, std::vector<float>& predictions) const {
+    static_assert(NFEATURES == PtNN::NNODES0, "NN inputs do not match the native NN");
+    const int n = features.size() / NFEATURES;
+    assert(predictions.size() == (size_t) n * NPREDICTIONS);
+
+    const float reg_pt_scale = 100.;  // a scale factor applied to regression during training
+    for (int i = 0; i < n; ++i) {
+      float regr = 0., discr = 0.;
+      nativeNN.predict(&features[i * NFEATURES], regr, discr);
+      predictions[i * NPREDICTIONS + 0] = regr / reg_pt_scale; // q/pT
+      predictions[i * NPREDICTIONS + 1] = discr; // PU discr
+    }
     return;
   }
 
@@ -1667,6 +1586,9 @@ private:
   std::string pbFileName;
   std::string inputName;
   std::vector<std::string> outputNames;
+
+  // Native NN, with the weights of the same graph
+  PtNN nativeNN;
 };
 
 // TrackProducer class does 2 things: apply scaling (or calibration) to the NN
@@ -1814,81 +1736,7 @@ private:
 // This is very similar to the RoadCleaning, but now it is done on the tracks
 // from all the sectors.
 
-class GhostBusting {
-public:
-  void run(std::vector<Track>& tracks) const {
-
-    std::vector<Track> tracks_after_gb;
-
-    // Sort by (zone, y_discr)
-    // zone is reordered such that zone 6 has the lowest priority.
-    constexpr auto sort_tracks_f = [](const Track& lhs, const Track& rhs) {
-      // (max zone, max y_discr) is better
-      auto lhs_zone = (lhs.zone+1) % 7;
-      auto rhs_zone = (rhs.zone+1) % 7;
-      return std::tie(lhs_zone, lhs.y_discr) > std::tie(rhs_zone, rhs.y_discr);
-    };
-    std::sort(tracks.begin(), tracks.end(), sort_tracks_f);
-
-    // Loop over the sorted tracks and remove duplicates (ghosts)
-    for (size_t i=0; i<tracks.size(); ++i) {
-      bool keep = true;
-
-      // Do not share ME1/1, ME1/2, ME0, MB1, MB2
-      // Need to check for neighbor sector hits
-      if (keep) {
-        using int32_t_pair = std::pair<int32_t, int32_t>;  // emtf_layer, emtf_phi
-
-        constexpr auto make_hit_set = [](const auto& hits) {
-          std::set<int32_t_pair> s;
-          for (const auto& hit : hits) {
-            if ((hit.emtf_layer == 0) ||
-                (hit.emtf_layer == 1) ||
-                (hit.emtf_layer == 11) ||
-                (hit.emtf_layer == 12) ||
-                (hit.emtf_layer == 13) ) {
-
-              int32_t tmp_endsec = hit.endsec;
-              int32_t tmp_emtf_phi = hit.emtf_phi;
-              if (hit.emtf_phi < (22*60)) {  // is a neighbor hit
-                if ((hit.endsec == 0) || (hit.endsec == 6)) {
-                  tmp_endsec += 5;
-                } else if ((1 <= hit.endsec && hit.endsec <= 5) || (7 <= hit.endsec && hit.endsec <= 11)) {
-                  tmp_endsec -= 1;
-                }
-                tmp_emtf_phi += (60*60);
-              }
-              s.insert(std::make_pair(tmp_endsec*100 + hit.emtf_layer, tmp_emtf_phi));
-            }
-          }
-          return s;
-        };
-
-        const auto& track_i = tracks[i];
-        const std::set<int32_t_pair>& s1 = make_hit_set(track_i.hits);
-        for (size_t j=0; j<i; ++j) {
-          const auto& track_j = tracks[j];
-          const std::set<int32_t_pair>& s2 = make_hit_set(track_j.hits);
-
-          std::vector<int32_t_pair> v_intersection;
-          std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(v_intersection));
-          if (!v_intersection.empty()) {  // has sharing
-            keep = false;
-            break;
-          }
-        }  // end inner loop over tracks[:i]
-      }
-
-      if (keep) {
-        const auto& track_i = tracks[i];
-        tracks_after_gb.push_back(track_i);
-      }
-    }  // end loop over tracks
-
-    std::swap(tracks, tracks_after_gb);
-    return;
-  }
-};
+#include "ghostbusting.icc"
 
 // TrackConverter class converts the internal Track object into EMTFTrack.
 // The EMTFTrackCollection can be used by the rest of CMSSW.
@@ -1997,35 +1845,119 @@ constexpr TrackConverter trkconv;
 
 
 // _____________________________________________________________________________
-void Phase2SectorProcessor::build_tracks(
+Phase2Context::Phase2Context() {
+#ifdef PR_IO_FILE
+  pattrec_file.open("pattrec.csv");  // Overwrite existing file
+  pattrec_file << std::setw(8);
+  pattrec_file << "name,st,ph,th," << std::endl;
+#endif /* PR_IO_FILE */
+}
+
+Phase2Context::~Phase2Context() {
+
+}
+
+// _____________________________________________________________________________
+Phase2SectorProcessor::Phase2SectorProcessor() {
+
+}
+
+Phase2SectorProcessor::~Phase2SectorProcessor() {
+
+}
+
+// _____________________________________________________________________________
+void Phase2SectorProcessor::build_roads(
     // Input
-    const EMTFHitCollection& conv_hits,
+    const EMTFHitCollection& conv_hits
+) {
+  // Containers for each sector, kept for build_tracks()
+  hits_.clear();
+  roads_.clear();
+  clean_roads_.clear();
+  slim_roads_.clear();
+  features_.clear();
+  predictions_.clear();
+
+  // Run the algorithms
+  recog.run(endcap_, sector_, conv_hits, hits_, roads_, pattern_buffers_, context_->pattrec_file);
+  clean.run(roads_, clean_roads_);
+  slim.run(clean_roads_, slim_roads_);
+  assig.run(slim_roads_, features_);
+  return;
+}
+
+// _____________________________________________________________________________
+void Phase2SectorProcessor::assign_pt(emtf::sector_array<Phase2SectorProcessor>& sector_processors, Phase2Context& context, bool use_native_nn) {
+  // Stack the NN inputs of all the sector processors
+  std::vector<float>& features = context.features;
+  std::vector<float>& predictions = context.predictions;
+  features.clear();
+  for (const auto& sp : sector_processors) {
+    features.insert(features.end(), sp.features_.begin(), sp.features_.end());
+  }
+
+  assig.predict(features, predictions, use_native_nn);
+
+  // Give the NN outputs back to each sector processor, in the same order
+  size_t offset = 0;
+  for (auto& sp : sector_processors) {
+    size_t n = sp.features_.size() / NFEATURES * NPREDICTIONS;
+    sp.predictions_.assign(predictions.begin() + offset, predictions.begin() + offset + n);
+    offset += n;
+  }
+  assert(offset == predictions.size());
+  return;
+}
+
+// _____________________________________________________________________________
+void Phase2SectorProcessor::build_tracks(
     // Output
     std::vector<Track>& best_tracks
 ) const {
   // Containers for each sector
-  std::vector<Hit> hits;
-  std::vector<Road> roads, clean_roads, slim_roads;
-  std::vector<Feature> features;
   std::vector<Prediction> predictions;
   std::vector<Track> tracks;
 
+  assert(slim_roads_.size() * NPREDICTIONS == predictions_.size());
+  for (size_t i = 0; i < slim_roads_.size(); ++i) {
+    Prediction prediction;
+    std::copy(predictions_.begin() + i * NPREDICTIONS, predictions_.begin() + (i+1) * NPREDICTIONS, prediction.begin());
+    predictions.push_back(prediction);
+  }
+
   // Run the algorithms
-  recog.run(endcap_, sector_, conv_hits, hits, roads);
-  clean.run(roads, clean_roads);
-  slim.run(clean_roads, slim_roads);
-  assig.run(slim_roads, features, predictions);
-  trkprod.run(slim_roads, predictions, tracks);
+  trkprod.run(slim_roads_, predictions, tracks);
 
-  best_tracks.insert(best_tracks.end(), tracks.begin(), tracks.end());  // best_tracks collects tracks from all sectors (CUIDADO: doesn't work!)
-  if (endcap_ == 2 && sector_ == 6) {  // using the last sector processor as uGMT to do ghost busting
-    ghost.run(best_tracks);
-  }
+  best_tracks.insert(best_tracks.end(), tracks.begin(), tracks.end());
 
   // Debug
   bool debug = false;
   if (debug) {
-    debug_tracks(hits, roads, clean_roads, slim_roads, tracks);
+    debug_tracks(hits_, roads_, clean_roads_, slim_roads_, tracks);
+  }
+  return;
+}
+
+// _____________________________________________________________________________
+void Phase2SectorProcessor::remove_ghosts(emtf::sector_array<Phase2SectorProcessor>& sector_processors, Phase2Context& context) {
+  // Collect the tracks of all the sector processors
+  std::vector<Track>& tracks = context.tracks;
+  tracks.clear();
+  for (const auto& sp : sector_processors) {
+    tracks.insert(tracks.end(), sp.best_tracks_.begin(), sp.best_tracks_.end());
+  }
+
+  // Run the algorithms
+  ghost.run(tracks);
+
+  // Give the remaining tracks back to the sector processor that built them
+  for (auto& sp : sector_processors) {
+    sp.best_tracks_.clear();
+  }
+  for (const auto& track : tracks) {
+    const int es = (track.endcap - emtf::MIN_ENDCAP) * (emtf::MAX_TRIGSECTOR - emtf::MIN_TRIGSECTOR + 1) + (track.sector - emtf::MIN_TRIGSECTOR);
+    sector_processors.at(es).best_tracks_.push_back(track);
   }
   return;
 }
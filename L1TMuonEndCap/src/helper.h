@@ -302,4 +302,80 @@ namespace {
     }
   }
 
+  // Finds the element that merge_sort3() would put in front, without sorting.
+  // The first element of a merge only depends on the first elements of the
+  // lists to be merged, so the same comparisons are done as a tournament.
+  // Returns 'last' if the container is empty.
+  template<typename RandomAccessIterator, typename Compare, typename Compare3>
+  RandomAccessIterator merge_sort_fronts_of_3(RandomAccessIterator first, RandomAccessIterator one_third, RandomAccessIterator two_third, RandomAccessIterator last, Compare cmp, Compare3 cmp3);
+
+  template<typename RandomAccessIterator, typename Compare, typename Compare3>
+  RandomAccessIterator merge_sort3_front(RandomAccessIterator first, RandomAccessIterator last, Compare cmp, Compare3 cmp3)
+  {
+    const std::ptrdiff_t len = std::distance(first, last);
+    if (len > 1) {
+      RandomAccessIterator one_third = std::next(first, (len+2) / 3);
+      RandomAccessIterator two_third = std::next(first, (len+2) / 3 * 2);
+      return merge_sort_fronts_of_3(first, one_third, two_third, last, cmp, cmp3);
+    }
+    return first;
+  }
+
+  // See above. 'Hint' is provided to force the very first division, as in merge_sort3_with_hint().
+  template<typename RandomAccessIterator, typename Compare, typename Compare3>
+  RandomAccessIterator merge_sort3_front_with_hint(RandomAccessIterator first, RandomAccessIterator last, Compare cmp, Compare3 cmp3, std::ptrdiff_t d)
+  {
+    const std::ptrdiff_t len = std::distance(first, last);
+    if (len > 1) {
+      RandomAccessIterator one_third = std::next(first, d);
+      RandomAccessIterator two_third = std::next(first, d * 2);
+      return merge_sort_fronts_of_3(first, one_third, two_third, last, cmp, cmp3);
+    }
+    return first;
+  }
+
+  // The first step of merge_sort_merge3()
+  template<typename RandomAccessIterator, typename Compare, typename Compare3>
+  RandomAccessIterator merge_sort_fronts_of_3(RandomAccessIterator first, RandomAccessIterator one_third, RandomAccessIterator two_third, RandomAccessIterator last, Compare cmp, Compare3 cmp3)
+  {
+    RandomAccessIterator front1 = merge_sort3_front(first, one_third, cmp, cmp3);
+    RandomAccessIterator front2 = merge_sort3_front(one_third, two_third, cmp, cmp3);
+    RandomAccessIterator front3 = merge_sort3_front(two_third, last, cmp, cmp3);
+    bool has1 = (first != one_third);
+    bool has2 = (one_third != two_third);
+    bool has3 = (two_third != last);
+
+    if (has1 && has2 && has3) {
+      int rr = cmp3(*front1, *front2, *front3);
+      if (rr == 0) {
+        return front1;
+      } else if (rr == 1) {
+        return front2;
+      } else {
+        return front3;
+      }
+    }
+
+    if (!has3) {
+      // do nothing
+    } else if (!has2) {
+      front2 = front3;
+      has2   = has3;
+    } else if (!has1) {
+      front1 = front2;
+      has1   = has2;
+      front2 = front3;
+      has2   = has3;
+    }
+
+    if (has1 && has2) {
+      return cmp(*front2, *front1) ? front2 : front1;
+    } else if (has1) {
+      return front1;
+    } else if (has2) {
+      return front2;
+    }
+    return last;
+  }
+
 }  // namespace
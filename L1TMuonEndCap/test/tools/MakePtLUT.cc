@@ -1,6 +1,15 @@
 #include <memory>
 #include <vector>
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Framework/interface/EDAnalyzer.h"
@@ -13,7 +22,6 @@
 #include "L1Trigger/L1TMuonEndCap/interface/PtLUTWriter.h"
 
 #include "helper.h"
-#include "progress_bar.h"
 
 
 class MakePtLUT : public edm::EDAnalyzer {
@@ -44,6 +52,7 @@ private:
   int verbose_;
   int num_;
   int denom_;
+  int numThreads_;
 
   std::string xml_dir_;
   std::string outfile_;
@@ -65,6 +74,7 @@ MakePtLUT::MakePtLUT(const edm::ParameterSet& iConfig) :
     verbose_(iConfig.getUntrackedParameter<int>("verbosity")),
     num_(iConfig.getParameter<int>("numerator")),
     denom_(iConfig.getParameter<int>("denominator")),
+    numThreads_(iConfig.getUntrackedParameter<int>("numThreads", 0)),
     outfile_(iConfig.getParameter<std::string>("outfile")),
     onlyCheck_(iConfig.getParameter<bool>("onlyCheck")),
     addressesToCheck_(iConfig.getParameter<std::vector<unsigned long long> >("addressesToCheck")),
@@ -116,32 +126,108 @@ void MakePtLUT::makeLUT() {
   std::cout << "Calculating pT for " << PTLUT_SIZE / denom_ << " addresses, please sit tight..." << std::endl;
 
   if (num_ - 1 < 0) std::cout << "ERROR: tried to fill address < 0.  KILL!!!" << std::endl;
-  PtLUTWriter::address_t address = abs((num_ - 1) * (PTLUT_SIZE / denom_));
-
-  float xmlpt = 0.;
-  float pt = 0.;
-  int gmt_pt = 0;
-
-  for ( ; address < (PtLUTWriter::address_t) abs(num_ * (PTLUT_SIZE / denom_)); ++address) {
-    if (address % (PTLUT_SIZE / (denom_ * 128)) == 0)
-      show_progress_bar(address, PTLUT_SIZE);
-
-    //int mode_inv = (address >> (30-4)) & ((1<<4)-1);
-
-    // floats
-    xmlpt   = pt_assign_engine_->calculate_pt(address);
-    pt      = (xmlpt < 0.) ? 1. : xmlpt;  // Matt used fabs(-1) when mode is invalid
-    pt *= pt_assign_engine_->scale_pt(pt, 15);  // Multiply by some factor to achieve 90% efficiency at threshold
-
-    // integers
-    gmt_pt = (pt * 2) + 1;
-    gmt_pt = (gmt_pt > 511) ? 511 : gmt_pt;
-
-    //if (address % (1<<20) == 0)
-    //  std::cout << mode_inv << " " << address << " " << print_subaddresses(address) << " " << gmt_pt << std::endl;
-
-    ptlut_writer_.push_back(gmt_pt);
-  }
+  const PtLUTWriter::address_t address_begin = abs((num_ - 1) * (PTLUT_SIZE / denom_));
+  const PtLUTWriter::address_t address_end   = abs(num_ * (PTLUT_SIZE / denom_));
+
+  // The output is pre-sized, so that every thread writes its own slice of addresses
+  ptlut_writer_.resize(address_end - address_begin);
+
+  // Addresses are evaluated in batches, consecutive addresses mostly share the same mode
+  const PtLUTWriter::address_t batch_size = 4096;
+
+  std::atomic<PtLUTWriter::address_t> num_done(0);
+  std::mutex progress_mutex;
+  int progress_percent = -1;
+  const auto start_time = std::chrono::steady_clock::now();
+
+  auto report_progress = [&](PtLUTWriter::address_t done) {
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    int percent = (100 * done) / (address_end - address_begin);
+    if (percent <= progress_percent)
+      return;
+    progress_percent = percent;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    double rate = (elapsed > 0.) ? done / elapsed : 0.;
+    std::cout << "\r" << std::setw(3) << percent << "%  " << done << " addresses  "
+              << std::fixed << std::setprecision(2) << (rate / 1e6) << " M addresses/s  "
+              << std::setprecision(0) << ((rate > 0.) ? (address_end - address_begin - done) / rate : 0.) << " s remaining   ";
+    std::cout.flush();
+  };
+
+  // Addresses that unpack to the same BDT inputs as a smaller address in this slice (including all the
+  // addresses without a valid mode) are not evaluated: they are copied from that address afterwards
+  auto is_duplicate = [&](PtLUTWriter::address_t address) {
+    PtLUTWriter::address_t canonical = pt_assign_engine_->canonical_address(address);
+    return (canonical != address && canonical >= address_begin);
+  };
+
+  std::atomic<PtLUTWriter::address_t> num_calculated(0);
+
+  auto process_range = [&](const tbb::blocked_range<PtLUTWriter::address_t>& range) {
+    std::vector<PtAssignmentEngine::address_t> addresses(batch_size);
+    std::vector<float> xmlpts(batch_size);
+
+    float xmlpt = 0.;
+    float pt = 0.;
+    int gmt_pt = 0;
+
+    PtLUTWriter::address_t next_address = range.begin();
+
+    while (next_address < range.end()) {
+      unsigned int n = 0;
+      for (; n < batch_size && next_address < range.end(); ++next_address) {
+        if (!is_duplicate(next_address))
+          addresses[n++] = next_address;
+      }
+      num_calculated += n;
+
+      pt_assign_engine_->calculate_pt_batch(addresses.data(), n, xmlpts.data());
+
+      for (unsigned int i = 0; i < n; ++i) {
+        const PtLUTWriter::address_t address = addresses[i];
+
+        //int mode_inv = (address >> (30-4)) & ((1<<4)-1);
+
+        // floats
+        xmlpt   = xmlpts[i];
+        pt      = (xmlpt < 0.) ? 1. : xmlpt;  // Matt used fabs(-1) when mode is invalid
+        pt *= pt_assign_engine_->scale_pt(pt, 15);  // Multiply by some factor to achieve 90% efficiency at threshold
+
+        // integers
+        gmt_pt = (pt * 2) + 1;
+        gmt_pt = (gmt_pt > 511) ? 511 : gmt_pt;
+
+        //if (address % (1<<20) == 0)
+        //  std::cout << mode_inv << " " << address << " " << print_subaddresses(address) << " " << gmt_pt << std::endl;
+
+        ptlut_writer_.set(address - address_begin, gmt_pt);
+      }
+    }
+
+    report_progress(num_done += range.size());
+  };
+
+  // numThreads = 0 uses all the cores
+  tbb::task_arena arena(numThreads_ > 0 ? numThreads_ : static_cast<int>(tbb::task_arena::automatic));
+  arena.execute([&]() {
+    tbb::parallel_for(tbb::blocked_range<PtLUTWriter::address_t>(address_begin, address_end, batch_size), process_range);
+  });
+
+  // Fill the duplicates from their canonical address, which is always evaluated above
+  arena.execute([&]() {
+    tbb::parallel_for(tbb::blocked_range<PtLUTWriter::address_t>(address_begin, address_end, batch_size),
+                      [&](const tbb::blocked_range<PtLUTWriter::address_t>& range) {
+      for (PtLUTWriter::address_t address = range.begin(); address < range.end(); ++address) {
+        if (is_duplicate(address))
+          ptlut_writer_.set(address - address_begin, ptlut_writer_.get(pt_assign_engine_->canonical_address(address) - address_begin));
+      }
+    });
+  });
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  std::cout << "\nElapsed time: " << elapsed << " sec (" << arena.max_concurrency() << " threads)" << std::endl;
+  std::cout << "Evaluated " << num_calculated << " of " << (address_end - address_begin) << " addresses, the others were copied" << std::endl;
 
   std::cout << "\nAbout to write file " << outfile_ << " for part " << num_ << "/" << denom_ << std::endl;
   ptlut_writer_.write(outfile_, num_, denom_);
@@ -0,0 +1,151 @@
+#!/usr/bin/env python
+
+# Dump the weights of the Phase 2 pT NN from the frozen Tensorflow graph into
+# a C++ include file, for the native NN in src/experimental/Phase2SectorProcessor.cc
+#
+# The protobuf is decoded directly, so neither Tensorflow nor protobuf is needed.
+#
+# Usage: python export_nn_weights.py ../../data/emtfpp_tf_graphs/model_graph.27.pb ../../src/experimental/ptnnweights.icc
+
+from __future__ import print_function
+import sys
+import struct
+
+
+# ______________________________________________________________________________
+# Minimal protobuf wire-format decoder
+
+def read_varint(buf, i):
+  result = 0
+  shift = 0
+  while True:
+    c = bytearray(buf[i:i+1])[0]
+    i += 1
+    result |= (c & 0x7f) << shift
+    shift += 7
+    if c < 0x80:
+      return result, i
+
+def read_fields(buf):
+  i = 0
+  fields = []
+  while i < len(buf):
+    key, i = read_varint(buf, i)
+    field, wire_type = key >> 3, key & 7
+    if wire_type == 0:
+      value, i = read_varint(buf, i)
+    elif wire_type == 1:
+      value, i = buf[i:i+8], i+8
+    elif wire_type == 5:
+      value, i = buf[i:i+4], i+4
+    elif wire_type == 2:
+      length, i = read_varint(buf, i)
+      value, i = buf[i:i+length], i+length
+    else:
+      raise Exception('Unsupported wire type: %i' % wire_type)
+    fields.append((field, wire_type, value))
+  return fields
+
+def read_float_tensor(buf):
+  # TensorProto: dtype=1, tensor_shape=2, tensor_content=4, float_val=5
+  DT_FLOAT = 1
+  shape, values = [], []
+  for field, wire_type, value in read_fields(buf):
+    if field == 1:
+      assert(value == DT_FLOAT)
+    elif field == 2:
+      for f, w, dim in read_fields(value):
+        if f == 2:
+          shape.append(dict((ff, vv) for ff, ww, vv in read_fields(dim)).get(1, 0))
+    elif field == 4:
+      values = list(struct.unpack('<%if' % (len(value)//4), value))
+    elif field == 5:
+      if wire_type == 2:  # packed
+        values += list(struct.unpack('<%if' % (len(value)//4), value))
+      else:
+        values += list(struct.unpack('<f', value))
+  size = 1
+  for dim in shape:
+    size *= dim
+  if len(values) == 1 and size > 1:  # filled with a single value
+    values = values * size
+  assert(len(values) == size)
+  return shape, values
+
+def read_constants(pbfile):
+  # GraphDef: node=1; NodeDef: name=1, op=2, attr=5; AttrValue: tensor=8
+  with open(pbfile, 'rb') as f:
+    buf = f.read()
+  constants = {}
+  for field, wire_type, value in read_fields(buf):
+    if field != 1:
+      continue
+    name, op, attrs = None, None, {}
+    for f, w, v in read_fields(value):
+      if f == 1:
+        name = v.decode()
+      elif f == 2:
+        op = v.decode()
+      elif f == 5:
+        entry = dict((ff, vv) for ff, ww, vv in read_fields(v))
+        attrs[entry[1].decode()] = entry.get(2, b'')
+    if op == 'Const':
+      for f, w, v in read_fields(attrs['value']):
+        if f == 8:
+          try:
+            constants[name] = read_float_tensor(v)
+          except AssertionError:
+            pass  # not a float tensor
+  return constants
+
+
+# ______________________________________________________________________________
+def main():
+  if len(sys.argv) < 3:
+    print("Usage: %s model_graph.pb output.icc" % sys.argv[0])
+    return
+
+  pbfile, iccfile = sys.argv[1], sys.argv[2]
+  constants = read_constants(pbfile)
+
+  # Network: BN - (dense - BN - tanh) x 3 - dense (regr), dense + sigmoid (discr)
+  # Dense layers have no bias except for the output layers. The batch
+  # normalization uses the moving mean and variance (inference mode).
+  arrays = []
+  for i in range(1, 5):
+    bn = 'batch_normalization_%i' % i
+    for v in ['gamma', 'beta', 'moving_mean', 'moving_variance']:
+      arrays.append(('_nn_bn%i_%s' % (i, v), constants['%s/%s' % (bn, v)]))
+    arrays.append(('_nn_bn%i_epsilon' % i, constants['%s/cond/batchnorm/add/y' % bn]))
+  for i in range(1, 4):
+    arrays.append(('_nn_dense%i_kernel' % i, constants['dense_%i/kernel' % i]))
+  for v in ['regr', 'discr']:
+    arrays.append(('_nn_%s_kernel' % v, constants['%s/kernel' % v]))
+    arrays.append(('_nn_%s_bias' % v, constants['%s/bias' % v]))
+
+  blocks = []
+  for name, (shape, values) in arrays:
+    # '%.9g' is enough to get back the same float32
+    if not shape:
+      blocks.append('constexpr float %s = %.9g;\n' % (name, values[0]))
+      continue
+    dims = ''.join('[%i]' % dim for dim in shape)
+    ncols = shape[-1]
+    rows = [values[j:j+ncols] for j in range(0, len(values), ncols)]
+    opening, closing = ('{', '}') if len(shape) == 2 else ('', '')
+    lines = ['  %s%s%s' % (opening, ', '.join('%.9g' % x for x in row), closing) for row in rows]
+    blocks.append('constexpr float %s%s = {\n%s\n};\n' % (name, dims, ',\n'.join(lines)))
+
+  with open(iccfile, 'w') as f:
+    f.write('// Generated by test/tools/export_nn_weights.py from %s\n' % pbfile.split('/')[-1])
+    f.write('// Kernels are stored as [inputs][outputs], as in Tensorflow\n')
+    f.write('\n')
+    f.write('\n'.join(blocks))
+  print('Wrote %s' % iccfile)
+  return
+
+
+# ______________________________________________________________________________
+if __name__ == '__main__':
+
+  main()
@@ -19,6 +19,9 @@ process.analyzer1 = cms.EDAnalyzer("MakePtLUT",
     numerator    = cms.int32(iNum),
     denominator  = cms.int32(iDen),
 
+    # Number of threads used to fill the addresses (0 = all cores)
+    numThreads   = cms.untracked.int32(0),
+
     # Sector processor pt-assignment parameters
     spPAParams16 = cms.PSet(
         BDTXMLDir       = cms.string('2017_v7'),
@@ -0,0 +1,104 @@
+#include "Utilities/Testing/interface/CppUnit_testdriver.icpp"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <random>
+
+#include "L1Trigger/L1TMuonEndCap/interface/bdt/Forest.h"
+#include "L1Trigger/L1TMuonEndCap/interface/bdt/FlatForest.h"
+
+
+class TestFlatForest: public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(TestFlatForest);
+  CPPUNIT_TEST(test_predict);
+  CPPUNIT_TEST(test_predict_batch);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  TestFlatForest() {}
+  ~TestFlatForest() {}
+  void setUp();
+  void tearDown() {}
+
+  void test_predict();
+  void test_predict_batch();
+
+private:
+  void make_tree(L1TMuonEndCapForest::DTree& tree, int depth);
+
+  enum { NTREES = 400, NVARS = 20, NEVENTS = 1037 };
+
+  std::mt19937 rng_;
+  emtf::Forest forest_;
+  emtf::FlatForest flat_forest_;
+  std::vector<int> features_;
+};
+
+///registration of the test so that the runner can find it
+CPPUNIT_TEST_SUITE_REGISTRATION(TestFlatForest);
+
+
+using namespace emtf;
+
+// Append a random subtree in the condition payload format (ileft = iright = 0 for a terminal node)
+void TestFlatForest::make_tree(L1TMuonEndCapForest::DTree& tree, int depth)
+{
+  unsigned index = tree.size();
+  tree.push_back(L1TMuonEndCapForest::DTreeNode());
+  tree[index].splitVar = rng_() % NVARS;
+  tree[index].splitVal = 0.5 * static_cast<double>(static_cast<int>(rng_() % 81) - 40);  // split=[-20,20,step=0.5]
+  tree[index].fitVal = std::uniform_real_distribution<double>(-1., 1.)(rng_);
+  tree[index].ileft = 0;
+  tree[index].iright = 0;
+
+  if (depth > 0 && (rng_() % 4) != 0) {
+    tree[index].ileft = tree.size();
+    make_tree(tree, depth-1);
+    tree[index].iright = tree.size();
+    make_tree(tree, depth-1);
+  }
+}
+
+void TestFlatForest::setUp()
+{
+  rng_.seed(12345);
+
+  L1TMuonEndCapForest::DForest payload(NTREES);
+  for (auto& tree : payload)
+    make_tree(tree, 6);
+
+  forest_.loadFromCondPayload(payload);
+  forest_.getTree(0)->setBoostWeight(0.25);
+  flat_forest_.compile(forest_, NTREES);
+
+  features_.resize(NEVENTS * NVARS);
+  for (auto& x : features_)
+    x = static_cast<int>(rng_() % 51) - 25;  // x=[-25,25]
+}
+
+void TestFlatForest::test_predict()
+{
+  CPPUNIT_ASSERT_EQUAL(flat_forest_.size(), (unsigned int) NTREES);
+
+  for (int i = 0; i < NEVENTS; ++i) {
+    const int* x = &features_[i * NVARS];
+
+    Event event;
+    event.predictedValue = 0;
+    event.data = std::vector<double>(x, x + NVARS);
+    forest_.predictEvent(&event, NTREES);
+
+    // Same trees, same order of summation: results must be identical
+    CPPUNIT_ASSERT_EQUAL(event.predictedValue, flat_forest_.predict(x));
+  }
+}
+
+void TestFlatForest::test_predict_batch()
+{
+  std::vector<double> predictions(NEVENTS);
+  flat_forest_.predictBatch(features_.data(), NVARS, NEVENTS, predictions.data());
+
+  for (int i = 0; i < NEVENTS; ++i) {
+    CPPUNIT_ASSERT_EQUAL(flat_forest_.predict(&features_[i * NVARS]), predictions[i]);
+  }
+}
@@ -0,0 +1,165 @@
+#include "Utilities/Testing/interface/CppUnit_testdriver.icpp"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+namespace {
+  // Only the fields used by GhostBusting, see src/experimental/Phase2SectorProcessor.cc
+  class Hit {
+  public:
+    int32_t emtf_layer;
+    int32_t endsec;
+    int32_t emtf_phi;
+  };
+
+  class Track {
+  public:
+    int16_t zone;
+    float y_discr;
+    std::vector<Hit> hits;
+    int id;  // to compare the outputs
+  };
+
+#include "L1Trigger/L1TMuonEndCap/src/experimental/ghostbusting.icc"
+}
+
+
+class TestGhostBusting: public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(TestGhostBusting);
+  CPPUNIT_TEST(test_ghost_busting);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  TestGhostBusting() {}
+  ~TestGhostBusting() {}
+  void setUp() { rng_.seed(20190101); }
+  void tearDown() {}
+
+  void test_ghost_busting();
+
+private:
+  // Comparison of the hit sets with std::set_intersection, as done before
+  void reference(std::vector<Track>& tracks) const;
+
+  std::vector<Track> make_tracks(int n);
+
+  std::mt19937 rng_;
+};
+
+///registration of the test so that the runner can find it
+CPPUNIT_TEST_SUITE_REGISTRATION(TestGhostBusting);
+
+
+void TestGhostBusting::test_ghost_busting()
+{
+  GhostBusting ghost;
+
+  for (int i = 0; i < 3000; ++i) {
+    std::vector<Track> tracks = make_tracks(rng_() % 40);
+    std::vector<Track> ref_tracks = tracks;
+
+    ghost.run(tracks);
+    reference(ref_tracks);
+
+    CPPUNIT_ASSERT_EQUAL(ref_tracks.size(), tracks.size());
+    for (unsigned itrack = 0; itrack < tracks.size(); ++itrack) {
+      CPPUNIT_ASSERT_EQUAL(ref_tracks.at(itrack).id, tracks.at(itrack).id);
+    }
+  }
+}
+
+std::vector<Track> TestGhostBusting::make_tracks(int n)
+{
+  // Few distinct values, so that the tracks share hits and tie in the sort
+  constexpr int32_t layers[7] = {0, 1, 2, 11, 12, 13, 5};
+
+  std::vector<Track> tracks;
+  for (int i = 0; i < n; ++i) {
+    Track track;
+    track.zone = rng_() % 7;
+    track.y_discr = (rng_() % 5) / 4.f;
+    track.id = i;
+
+    const int nhits = rng_() % 6;
+    for (int ihit = 0; ihit < nhits; ++ihit) {
+      Hit hit;
+      hit.emtf_layer = layers[rng_() % 7];
+      hit.endsec = rng_() % 12;
+      hit.emtf_phi = (rng_() % 4) * 700;  // some are neighbor hits (emtf_phi < 22*60)
+      track.hits.push_back(hit);
+    }
+    tracks.push_back(track);
+  }
+  return tracks;
+}
+
+void TestGhostBusting::reference(std::vector<Track>& tracks) const
+{
+  std::vector<Track> tracks_after_gb;
+
+  // Sort by (zone, y_discr), with the same stable sort as GhostBusting
+  constexpr auto sort_tracks_f = [](const Track& lhs, const Track& rhs) {
+    auto lhs_zone = (lhs.zone+1) % 7;
+    auto rhs_zone = (rhs.zone+1) % 7;
+    return std::tie(lhs_zone, lhs.y_discr) > std::tie(rhs_zone, rhs.y_discr);
+  };
+  std::stable_sort(tracks.begin(), tracks.end(), sort_tracks_f);
+
+  using int32_t_pair = std::pair<int32_t, int32_t>;  // emtf_layer, emtf_phi
+
+  constexpr auto make_hit_set = [](const auto& hits) {
+    std::set<int32_t_pair> s;
+    for (const auto& hit : hits) {
+      if ((hit.emtf_layer == 0) ||
+          (hit.emtf_layer == 1) ||
+          (hit.emtf_layer == 11) ||
+          (hit.emtf_layer == 12) ||
+          (hit.emtf_layer == 13) ) {
+
+        int32_t tmp_endsec = hit.endsec;
+        int32_t tmp_emtf_phi = hit.emtf_phi;
+        if (hit.emtf_phi < (22*60)) {  // is a neighbor hit
+          if ((hit.endsec == 0) || (hit.endsec == 6)) {
+            tmp_endsec += 5;
+          } else if ((1 <= hit.endsec && hit.endsec <= 5) || (7 <= hit.endsec && hit.endsec <= 11)) {
+            tmp_endsec -= 1;
+          }
+          tmp_emtf_phi += (60*60);
+        }
+        s.insert(std::make_pair(tmp_endsec*100 + hit.emtf_layer, tmp_emtf_phi));
+      }
+    }
+    return s;
+  };
+
+  for (size_t i=0; i<tracks.size(); ++i) {
+    bool keep = true;
+
+    const std::set<int32_t_pair>& s1 = make_hit_set(tracks[i].hits);
+    for (size_t j=0; j<i; ++j) {
+      const std::set<int32_t_pair>& s2 = make_hit_set(tracks[j].hits);
+
+      std::vector<int32_t_pair> v_intersection;
+      std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(v_intersection));
+      if (!v_intersection.empty()) {  // has sharing
+        keep = false;
+        break;
+      }
+    }
+
+    if (keep) {
+      tracks_after_gb.push_back(tracks[i]);
+    }
+  }
+
+  std::swap(tracks, tracks_after_gb);
+}
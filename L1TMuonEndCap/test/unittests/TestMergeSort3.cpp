@@ -0,0 +1,114 @@
+#include "Utilities/Testing/interface/CppUnit_testdriver.icpp"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "L1Trigger/L1TMuonEndCap/src/helper.h"
+
+
+class TestMergeSort3: public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(TestMergeSort3);
+  CPPUNIT_TEST(test_front);
+  CPPUNIT_TEST(test_front_with_hint);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  TestMergeSort3() {}
+  ~TestMergeSort3() {}
+  void setUp() { rng_.seed(20190101); }
+  void tearDown() {}
+
+  void test_front();
+  void test_front_with_hint();
+
+private:
+  typedef std::pair<int, int> value_type;  // key=ph_diff, value=index
+
+  std::vector<value_type> make_array(int n);
+
+  std::mt19937 rng_;
+};
+
+///registration of the test so that the runner can find it
+CPPUNIT_TEST_SUITE_REGISTRATION(TestMergeSort3);
+
+
+namespace {
+  // Same comparators as in src/PrimitiveMatching.cc
+  struct {
+    typedef std::pair<int, int> value_type;
+    bool operator()(const value_type& lhs, const value_type& rhs) const {
+      return lhs.first <= rhs.first;
+    }
+  } less_cmp;
+
+  struct {
+    typedef std::pair<int, int> value_type;
+    int operator()(const value_type& a, const value_type& b, const value_type& c) const {
+      int r = 0;
+      r |= bool(a.first <= b.first);
+      r <<= 1;
+      r |= bool(b.first <= c.first);
+      r <<= 1;
+      r |= bool(c.first <= a.first);
+
+      int rr = 0;
+      switch(r) {
+      case 0b001 : rr = 2; break;  // c
+      case 0b010 : rr = 1; break;  // b
+      case 0b011 : rr = 1; break;  // b
+      case 0b100 : rr = 0; break;  // a
+      case 0b101 : rr = 2; break;  // c
+      case 0b110 : rr = 0; break;  // a
+      default    : rr = 0; break;
+      }
+      return rr;
+    }
+  } less_cmp3;
+}
+
+std::vector<TestMergeSort3::value_type> TestMergeSort3::make_array(int n)
+{
+  // Few distinct keys, so that the tie-breaking is tested
+  std::vector<value_type> v;
+  for (int i = 0; i < n; ++i) {
+    int key = (rng_() % 3 == 0) ? 0x1ff : (rng_() % 4);
+    v.push_back(std::make_pair(key, i));
+  }
+  return v;
+}
+
+void TestMergeSort3::test_front()
+{
+  for (int n = 1; n <= 64; ++n) {
+    for (int i = 0; i < 200; ++i) {
+      std::vector<value_type> v = make_array(n);
+      std::vector<value_type> sorted = v;
+      merge_sort3(sorted.begin(), sorted.end(), less_cmp, less_cmp3);
+
+      auto front = merge_sort3_front(v.begin(), v.end(), less_cmp, less_cmp3);
+      CPPUNIT_ASSERT(front != v.end());
+      CPPUNIT_ASSERT(sorted.front() == *front);
+    }
+  }
+}
+
+void TestMergeSort3::test_front_with_hint()
+{
+  // Array sizes used in primitive matching
+  for (int n : {27, 54}) {
+    for (int i = 0; i < 2000; ++i) {
+      std::vector<value_type> v = make_array(n);
+      std::vector<value_type> sorted = v;
+      int d = (n == 54) ? n/2 : n/3;
+      merge_sort3_with_hint(sorted.begin(), sorted.end(), less_cmp, less_cmp3, d);
+
+      auto front = merge_sort3_front_with_hint(v.begin(), v.end(), less_cmp, less_cmp3, d);
+      CPPUNIT_ASSERT(front != v.end());
+      CPPUNIT_ASSERT(sorted.front() == *front);
+    }
+  }
+}
@@ -0,0 +1,248 @@
+#include "Utilities/Testing/interface/CppUnit_testdriver.icpp"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace {
+  // Only what is used by PatternGrid, see src/experimental/Phase2SectorProcessor.cc
+  constexpr int NLAYERS = 16;
+  constexpr int PATTERN_BANK_NPT = 18;
+  constexpr int PATTERN_BANK_NETA = 7;
+  constexpr int PATTERN_BANK_NLAYERS = NLAYERS;
+  constexpr int PATTERN_BANK_NVARS = 3;
+  constexpr int PATTERN_X_SEARCH_MIN = 33;
+  constexpr int PATTERN_X_SEARCH_MAX = 154-10+12;
+
+  class Hit {
+  public:
+    int32_t emtf_layer;
+    int32_t emtf_phi;
+    std::vector<int32_t> zones;  // instead of the zones from emtf_theta
+    int id;  // to compare the outputs
+  };
+
+  class Road {
+  public:
+    using road_hits_t = std::vector<Hit>;
+    using road_id_t = std::array<int32_t, 5>;
+
+    struct Hasher {
+      std::size_t operator()(const road_id_t& road_id) const {
+        std::size_t seed = 0;
+        for (const auto& x : road_id) {
+          seed = seed * 31 + x;
+        }
+        return seed;
+      }
+    };
+  };
+
+  class Utility {
+  public:
+    int32_t find_pattern_x(int32_t emtf_phi) const {
+      return (emtf_phi+16)/32;  // divide by 'quadstrip' unit (4 * 8)
+    }
+
+    const std::vector<int32_t>& find_emtf_zones(const Hit& hit) const {
+      return hit.zones;
+    }
+  };
+
+  class PatternBank {
+  public:
+    using patternbank_t = std::array<std::array<std::array<std::array<int32_t, PATTERN_BANK_NPT>,
+        PATTERN_BANK_NVARS>, PATTERN_BANK_NETA>, PATTERN_BANK_NLAYERS>;
+
+    patternbank_t x_array {};
+  };
+
+  class Phase2PatternBuffers {
+  public:
+    std::vector<int32_t> cell_counts;
+    std::vector<uint32_t> cell_layers;
+    std::vector<int32_t> touched_cells;
+    std::vector<int32_t> touched_offsets;
+    std::vector<int32_t> cell_hits;
+  };
+
+  const Utility util;
+  PatternBank bank;  // filled with random windows by the test
+
+#include "L1Trigger/L1TMuonEndCap/src/experimental/patterngrid.icc"
+}
+
+
+class TestPatternGrid: public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(TestPatternGrid);
+  CPPUNIT_TEST(test_pattern_grid);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  TestPatternGrid() {}
+  ~TestPatternGrid() {}
+  void setUp() { rng_.seed(20190101); }
+  void tearDown() {}
+
+  void test_pattern_grid();
+
+private:
+  // (road_id, hit ids) of each road
+  using road_t = std::pair<Road::road_id_t, std::vector<int> >;
+
+  // Map of road_id -> road_hits followed by a sort of the roads, as done before
+  void reference(int32_t endcap, int32_t sector, const std::vector<Hit>& sector_hits,
+                 std::vector<road_t>& roads) const;
+
+  void make_bank();
+
+  std::vector<Hit> make_hits(int n);
+
+  std::mt19937 rng_;
+};
+
+///registration of the test so that the runner can find it
+CPPUNIT_TEST_SUITE_REGISTRATION(TestPatternGrid);
+
+
+void TestPatternGrid::test_pattern_grid()
+{
+  PatternGrid grid;
+  Phase2PatternBuffers buffers;  // reused, as in Phase2SectorProcessor
+
+  for (int ibank = 0; ibank < 10; ++ibank) {
+    make_bank();
+
+    for (int i = 0; i < 300; ++i) {
+      int32_t endcap = 1 + rng_() % 2;
+      int32_t sector = 1 + rng_() % 6;
+      std::vector<Hit> sector_hits = make_hits(rng_() % 60);
+
+      std::vector<road_t> roads;
+      grid.run(endcap, sector, sector_hits, buffers, [&](const Road::road_id_t& road_id, const Road::road_hits_t& road_hits) {
+        std::vector<int> ids;
+        for (const auto& hit : road_hits) {
+          ids.push_back(hit.id);
+        }
+        roads.emplace_back(road_id, ids);
+      });
+
+      std::vector<road_t> ref_roads;
+      reference(endcap, sector, sector_hits, ref_roads);
+
+      CPPUNIT_ASSERT_EQUAL(ref_roads.size(), roads.size());
+      for (unsigned iroad = 0; iroad < roads.size(); ++iroad) {
+        CPPUNIT_ASSERT(ref_roads.at(iroad).first == roads.at(iroad).first);
+        CPPUNIT_ASSERT(ref_roads.at(iroad).second == roads.at(iroad).second);
+      }
+    }
+  }
+
+  // The grid must be left clean for the next call
+  CPPUNIT_ASSERT(std::all_of(buffers.cell_counts.begin(), buffers.cell_counts.end(), [](int32_t x) { return x == 0; }));
+  CPPUNIT_ASSERT(std::all_of(buffers.cell_layers.begin(), buffers.cell_layers.end(), [](uint32_t x) { return x == 0; }));
+}
+
+void TestPatternGrid::make_bank()
+{
+  // Windows of similar sizes as in src/experimental/patternbank.icc
+  for (auto& x_lay : bank.x_array) {
+    for (auto& x_zone : x_lay) {
+      for (int32_t ipt = 0; ipt != PATTERN_BANK_NPT; ++ipt) {
+        int32_t x0 = static_cast<int32_t>(rng_() % 36) - 26;
+        int32_t x1 = x0 + static_cast<int32_t>(rng_() % 7);
+        x_zone[0][ipt] = x0;
+        x_zone[1][ipt] = (x0 + x1) / 2;
+        x_zone[2][ipt] = x1;
+      }
+    }
+  }
+}
+
+std::vector<Hit> TestPatternGrid::make_hits(int n)
+{
+  std::vector<Hit> hits;
+  for (int i = 0; i < n; ++i) {
+    Hit hit;
+    hit.emtf_layer = rng_() % NLAYERS;
+    hit.emtf_phi = rng_() % 5040;
+    hit.id = i;
+
+    // Up to 3 distinct zones, including zone 6
+    int32_t zone = rng_() % PATTERN_BANK_NETA;
+    const int nzones = rng_() % 4;
+    for (int izone = 0; izone < nzones && zone < PATTERN_BANK_NETA; ++izone) {
+      hit.zones.push_back(zone);
+      zone += 1 + rng_() % 2;
+    }
+    hits.push_back(hit);
+  }
+  return hits;
+}
+
+void TestPatternGrid::reference(int32_t endcap, int32_t sector, const std::vector<Hit>& sector_hits,
+                                std::vector<road_t>& roads) const
+{
+  // Create a map of road_id -> road_hits
+  std::unordered_map<Road::road_id_t, Road::road_hits_t, Road::Hasher> amap;
+
+  // Loop over hits
+  for (const auto& hit : sector_hits) {
+    int32_t hit_lay = hit.emtf_layer;
+    int32_t hit_x   = util.find_pattern_x(hit.emtf_phi);
+    const auto& hit_zones = util.find_emtf_zones(hit);
+
+    // Loop over the zones that the hit is belong to
+    for (const auto& hit_zone : hit_zones) {
+      if (hit_zone == 6) {  // For now, ignore zone 6
+        continue;
+      }
+
+      // Pattern recognition
+      for (int32_t ipt = 0; ipt != PATTERN_BANK_NPT; ++ipt) {
+        int32_t x0 = bank.x_array[hit_lay][hit_zone][0][ipt];
+        int32_t x1 = bank.x_array[hit_lay][hit_zone][2][ipt];
+        for (int32_t x = x0; x != (x1+1); ++x) {
+          int32_t iphi = (hit_x - x);
+          int32_t ieta = hit_zone;
+
+          if ((PATTERN_X_SEARCH_MIN <= iphi) && (iphi <= PATTERN_X_SEARCH_MAX)) {
+            Road::road_id_t road_id {{endcap, sector, ipt, ieta, iphi}};
+            amap[road_id].push_back(hit);
+          }
+        }
+      }
+    }  // end loop over hit_zones
+  }  // end loop over sector_hits
+
+  // Create roads. PatternRecognition::create_road() rejects the roads with
+  // hits in only 1 layer.
+  for (const auto& kv : amap) {
+    const Road::road_id_t&   road_id   = kv.first;
+    const Road::road_hits_t& road_hits = kv.second;
+
+    std::vector<int> ids;
+    uint32_t layers = 0;
+    for (const auto& hit : road_hits) {
+      ids.push_back(hit.id);
+      layers |= (1u << hit.emtf_layer);
+    }
+    if (std::bitset<32>(layers).count() >= 2) {
+      roads.emplace_back(road_id, ids);
+    }
+  }
+
+  // Sort by road_id
+  std::sort(roads.begin(), roads.end(), [](const road_t& lhs, const road_t& rhs) {
+    return lhs.first < rhs.first;
+  });
+}
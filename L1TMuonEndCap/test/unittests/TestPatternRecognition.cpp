@@ -0,0 +1,276 @@
+#include "Utilities/Testing/interface/CppUnit_testdriver.icpp"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+#include "L1Trigger/L1TMuonEndCap/interface/PatternRecognition.h"
+
+
+class TestPatternRecognition: public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(TestPatternRecognition);
+  CPPUNIT_TEST(test_patterns);
+  CPPUNIT_TEST(test_sym_patterns);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  TestPatternRecognition() {}
+  ~TestPatternRecognition() {}
+  void setUp();
+  void tearDown() {}
+
+  void test_patterns();
+  void test_sym_patterns();
+
+private:
+  typedef PatternRecognition::pattern_ref_t pattern_ref_t;
+
+  void compare(bool useSymPatterns, bool useSecondEarliest, int bxWindow);
+
+  // Zone image rotated to every zone hit and ANDed with every pattern, as done before
+  void reference_single_zone(
+      int zone, int bx, int bxWindow, bool useSecondEarliest,
+      const std::vector<PhiMemoryImage>& patterns,
+      PhiMemoryImage cloned_image,
+      std::map<pattern_ref_t, int>& patt_lifetime_map,
+      EMTFRoadCollection& roads
+  ) const;
+
+  std::vector<PhiMemoryImage> make_patterns(const std::vector<std::string>& definitions) const;
+
+  std::vector<std::string> pattDefinitions_, symPattDefinitions_;
+  std::mt19937 rng_;
+};
+
+///registration of the test so that the runner can find it
+CPPUNIT_TEST_SUITE_REGISTRATION(TestPatternRecognition);
+
+
+void TestPatternRecognition::setUp()
+{
+  // From python/simEmtfDigis_cfi.py
+  pattDefinitions_ = {
+    "4,15:15,7:7,7:7,7:7",
+    "3,16:16,7:7,7:6,7:6",
+    "3,14:14,7:7,8:7,8:7",
+    "2,18:17,7:7,7:5,7:5",
+    "2,13:12,7:7,10:7,10:7",
+    "1,22:19,7:7,7:0,7:0",
+    "1,11:8,7:7,14:7,14:7",
+    "0,30:23,7:7,7:0,7:0",
+    "0,7:0,7:7,14:7,14:7",
+  };
+  symPattDefinitions_ = {
+    "4,15:15:15:15,7:7:7:7,7:7:7:7,7:7:7:7",
+    "3,16:16:14:14,7:7:7:7,8:7:7:6,8:7:7:6",
+    "2,18:17:13:12,7:7:7:7,10:7:7:4,10:7:7:4",
+    "1,22:19:11:8,7:7:7:7,14:7:7:0,14:7:7:0",
+    "0,30:23:7:0,7:7:7:7,14:7:7:0,14:7:7:0",
+  };
+  rng_.seed(20190101);
+}
+
+void TestPatternRecognition::test_patterns()
+{
+  for (int bxWindow = 1; bxWindow <= 3; ++bxWindow) {
+    compare(false, false, bxWindow);
+    compare(false, true, bxWindow);
+  }
+}
+
+void TestPatternRecognition::test_sym_patterns()
+{
+  for (int bxWindow = 1; bxWindow <= 3; ++bxWindow) {
+    compare(true, false, bxWindow);
+    compare(true, true, bxWindow);
+  }
+}
+
+void TestPatternRecognition::compare(bool useSymPatterns, bool useSecondEarliest, int bxWindow)
+{
+  PatternRecognition patt_recog;
+  patt_recog.configure(0, 1, 1, bxWindow, pattDefinitions_, symPattDefinitions_, useSymPatterns, 3, useSecondEarliest);
+
+  const std::vector<PhiMemoryImage> patterns = make_patterns(useSymPatterns ? symPattDefinitions_ : pattDefinitions_);
+
+  PatternLifetime patt_lifetime;
+  std::map<pattern_ref_t, int> ref_patt_lifetime_map;
+
+  for (int bx = 0; bx < 200; ++bx) {
+    const int zone = 1 + (rng_() % emtf::NUM_ZONES);
+    const int nhits = (bx % 10 == 9) ? 0 : (rng_() % 24);  // some empty BX to let the patterns expire
+
+    PhiMemoryImage image;
+    for (int ihit = 0; ihit < nhits; ++ihit)
+      image.set_bit(rng_() % 4, rng_() % emtf::NUM_ZONE_HITS);
+
+    EMTFRoadCollection roads, ref_roads;
+    patt_recog.process_single_zone(zone, bx, image, patt_lifetime, roads);
+    reference_single_zone(zone, bx, bxWindow, useSecondEarliest, patterns, image, ref_patt_lifetime_map, ref_roads);
+
+    CPPUNIT_ASSERT_EQUAL(ref_roads.size(), roads.size());
+    for (unsigned iroad = 0; iroad < roads.size(); ++iroad) {
+      CPPUNIT_ASSERT_EQUAL(ref_roads.at(iroad).Key_zhit(), roads.at(iroad).Key_zhit());
+      CPPUNIT_ASSERT_EQUAL(ref_roads.at(iroad).Pattern(), roads.at(iroad).Pattern());
+      CPPUNIT_ASSERT_EQUAL(ref_roads.at(iroad).Layer_code(), roads.at(iroad).Layer_code());
+      CPPUNIT_ASSERT_EQUAL(ref_roads.at(iroad).Quality_code(), roads.at(iroad).Quality_code());
+      CPPUNIT_ASSERT_EQUAL(ref_roads.at(iroad).BX(), roads.at(iroad).BX());
+    }
+
+    // Same pattern lifetimes, 0 for the patterns that are not in the map
+    for (int izone = 0; izone < emtf::NUM_ZONES; ++izone) {
+      for (int izhit = 0; izhit < emtf::NUM_ZONE_HITS; ++izhit) {
+        bool is_alive = false;
+        for (int ipatt = 0; ipatt < (int) patterns.size(); ++ipatt) {
+          const pattern_ref_t patt_ref = {{izone+1, izhit, ipatt}};
+          auto found = ref_patt_lifetime_map.find(patt_ref);
+          int ref_lifetime = (found != ref_patt_lifetime_map.end()) ? found->second : 0;
+          CPPUNIT_ASSERT_EQUAL(ref_lifetime, (int) patt_lifetime.at(izone, izhit, ipatt));
+          is_alive |= (ref_lifetime != 0);
+        }
+        CPPUNIT_ASSERT_EQUAL(is_alive, (bool) ((patt_lifetime.alive(izone)[izhit / 64] >> (izhit % 64)) & 1));
+      }
+      CPPUNIT_ASSERT_EQUAL(patt_lifetime.is_zone_empty(izone), (bool) std::none_of(ref_patt_lifetime_map.begin(), ref_patt_lifetime_map.end(), [izone](const std::pair<const pattern_ref_t, int>& kv) { return kv.first.at(0) == izone+1; }));
+    }
+  }
+}
+
+std::vector<PhiMemoryImage> TestPatternRecognition::make_patterns(const std::vector<std::string>& definitions) const
+{
+  // "straightness,max:min[:max:min],..." with ME1 centered at 15 and ME2,3,4 centered at 7
+  std::vector<PhiMemoryImage> patterns;
+
+  for (const auto& s : definitions) {
+    std::stringstream ss(s);
+    std::string token;
+    std::getline(ss, token, ',');
+
+    PhiMemoryImage pattern;
+    pattern.set_straightness(std::stoi(token));
+
+    for (int layer = 0; layer < 4; ++layer) {
+      std::getline(ss, token, ',');
+      std::stringstream st(token);
+      std::string smax, smin;
+      while (std::getline(st, smax, ':') && std::getline(st, smin, ':')) {
+        int offset = (layer == 0) ? 0 : 8;  // extra padding in ME1
+        for (int i = std::stoi(smin); i <= std::stoi(smax); ++i)
+          pattern.set_bit(layer, i + offset);
+      }
+    }
+    pattern.rotr(8);
+    patterns.push_back(pattern);
+  }
+  return patterns;
+}
+
+void TestPatternRecognition::reference_single_zone(
+    int zone, int bx, int bxWindow, bool useSecondEarliest,
+    const std::vector<PhiMemoryImage>& patterns,
+    PhiMemoryImage cloned_image,
+    std::map<pattern_ref_t, int>& patt_lifetime_map,
+    EMTFRoadCollection& roads
+) const
+{
+  roads.clear();
+
+  const int drift_time = bxWindow - 1;
+  const int npatterns = patterns.size();
+
+  cloned_image.rotl(7);
+
+  for (int izhit = 0; izhit < emtf::NUM_ZONE_HITS; ++izhit) {
+    if (izhit > 0)
+      cloned_image.rotr(1);
+
+    int max_quality_code = -1;
+    EMTFRoad tmp_road;
+
+    for (int ipatt = 0; ipatt < npatterns; ++ipatt) {
+      const PhiMemoryImage& patt = patterns.at(ipatt);
+      const pattern_ref_t patt_ref = {{zone, izhit, ipatt}};
+      int straightness = patt.get_straightness();
+
+      bool is_lifetime_up = false;
+
+      int layer_code = patt.op_and(cloned_image);
+      bool more_than_one  = (layer_code != 0) && (layer_code != 1) && (layer_code != 2) && (layer_code != 4);
+      bool more_than_zero = (layer_code != 0);
+
+      if (more_than_zero) {
+        auto ins = patt_lifetime_map.insert({patt_ref, 0});
+
+        if (!useSecondEarliest) {
+          if (!ins.second && ins.first->second == drift_time)
+            is_lifetime_up = true;
+          ins.first->second += 1;
+
+        } else {
+          int bx_shifter = ins.first->second;
+          int bx2 = bool(bx_shifter & (1<<2));
+          int bx1 = bool(bx_shifter & (1<<1));
+          int bx0 = bool(bx_shifter & (1<<0));
+
+          if (drift_time == 2 && bx2 == 0 && bx1 == 1)
+            is_lifetime_up = true;
+          else if (drift_time == 1 && bx1 == 0 && bx0 == 1)
+            is_lifetime_up = true;
+          else if (drift_time == 0)
+            is_lifetime_up = true;
+
+          ins.first->second = (bx1 << 2) | (bx0 << 1) | 1;
+        }
+
+      } else {
+        patt_lifetime_map.erase(patt_ref);
+      }
+
+      if (is_lifetime_up && more_than_one) {
+        int quality_code = (
+            (((straightness>>2) & 1) << 5) |
+            (((straightness>>1) & 1) << 3) |
+            (((straightness>>0) & 1) << 1) |
+            (((layer_code>>2)   & 1) << 4) |
+            (((layer_code>>1)   & 1) << 2) |
+            (((layer_code>>0)   & 1) << 0)
+        );
+
+        EMTFRoad road;
+        road.set_bx           ( bx - drift_time );
+        road.set_zone         ( zone );
+        road.set_key_zhit     ( izhit );
+        road.set_pattern      ( ipatt );
+        road.set_straightness ( straightness );
+        road.set_layer_code   ( layer_code );
+        road.set_quality_code ( quality_code );
+
+        if (max_quality_code < quality_code) {
+          max_quality_code = quality_code;
+          tmp_road = road;
+        }
+      }
+    }
+
+    if (max_quality_code != -1)
+      roads.push_back(tmp_road);
+  }
+
+  // Ghost cancellation
+  std::array<int, emtf::NUM_ZONE_HITS> quality_codes;
+  quality_codes.fill(0);
+  for (const auto& road : roads)
+    quality_codes.at(road.Key_zhit()) = road.Quality_code();
+
+  EMTFRoadCollection tmp_roads;
+  for (const auto& road : roads) {
+    int izhit = road.Key_zhit();
+    int qc = quality_codes.at(izhit);
+    int ql = (izhit == emtf::NUM_ZONE_HITS-1) ? 0 : quality_codes.at(izhit+1);
+    int qr = (izhit == 0) ? 0 : quality_codes.at(izhit-1);
+    if (!(qc <= ql || qc < qr))
+      tmp_roads.push_back(road);
+  }
+  std::swap(roads, tmp_roads);
+}
@@ -2,8 +2,14 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include "PhysicsTools/TensorFlow/interface/TensorFlow.h"
 
+#include "L1Trigger/L1TMuonEndCap/src/experimental/ptnn.icc"
+
 // Reference: https://www.tensorflow.org/api_docs/cc
 
 std::string cmsswPath(std::string path)
@@ -23,6 +29,8 @@ class TestTensorFlow: public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE(TestTensorFlow);
   CPPUNIT_TEST(test_loading);
+  CPPUNIT_TEST(test_native);
+  CPPUNIT_TEST(test_batch);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -30,6 +38,8 @@ public:
   void tearDown();
 
   void test_loading();
+  void test_native();
+  void test_batch();
 
 private:
   std::vector<float> x_test_0;
@@ -203,3 +213,104 @@ void TestTensorFlow::test_loading()
   CPPUNIT_ASSERT(tensorflow::closeSession(session));
   delete graphDef;
 }
+
+void TestTensorFlow::test_native()
+{
+  // The native NN must agree with the graph its weights are exported from
+  std::string pbFile = cmsswPath("/src/L1Trigger/L1TMuonEndCap/data/emtfpp_tf_graphs/model_graph.27.pb");
+
+  tensorflow::setLogging();
+  tensorflow::GraphDef* graphDef = tensorflow::loadGraphDef(pbFile);
+  CPPUNIT_ASSERT(graphDef != nullptr);
+  tensorflow::Session* session = tensorflow::createSession(graphDef);
+  CPPUNIT_ASSERT(session != nullptr);
+
+  const PtNN nn;
+
+  auto almost_equal = [](auto a, auto b) {
+    auto relative_difference = std::abs((a - b) / std::min(std::abs(a), std::abs(b)));
+    return (relative_difference < 1e-5);
+  };
+
+  const std::vector<float>* x_tests[10] = {
+    &x_test_0, &x_test_1, &x_test_2, &x_test_3, &x_test_4,
+    &x_test_5, &x_test_6, &x_test_7, &x_test_8, &x_test_9
+  };
+
+  for (const auto* x : x_tests) {
+    CPPUNIT_ASSERT(x->size() == PtNN::NNODES0);
+
+    tensorflow::Tensor input(tensorflow::DT_FLOAT, { 1, PtNN::NNODES0 });
+    std::copy(x->begin(), x->end(), input.flat<float>().data());
+    std::vector<tensorflow::Tensor> outputs;
+    tensorflow::Status status = session->Run({ { "input_1", input } }, { "regr/BiasAdd", "discr/Sigmoid" }, {}, &outputs);
+    CPPUNIT_ASSERT(status.ok());
+    CPPUNIT_ASSERT(outputs.size() == 2);
+
+    float regr = 0., discr = 0.;
+    nn.predict(x->data(), regr, discr);
+    CPPUNIT_ASSERT(almost_equal(regr, outputs[0].matrix<float>()(0, 0)) );
+    CPPUNIT_ASSERT(almost_equal(discr, outputs[1].matrix<float>()(0, 0)) );
+  }
+
+  // cleanup
+  CPPUNIT_ASSERT(tensorflow::closeSession(session));
+  delete graphDef;
+}
+
+void TestTensorFlow::test_batch()
+{
+  // Phase2SectorProcessor::assign_pt evaluates the roads of all the sectors
+  // as one {N,36} batch. Check that each row gives the same outputs as when
+  // evaluated alone as a {1,36} batch.
+  std::string pbFile = cmsswPath("/src/L1Trigger/L1TMuonEndCap/data/emtfpp_tf_graphs/model_graph.27.pb");
+
+  tensorflow::setLogging();
+  tensorflow::GraphDef* graphDef = tensorflow::loadGraphDef(pbFile);
+  CPPUNIT_ASSERT(graphDef != nullptr);
+  tensorflow::Session* session = tensorflow::createSession(graphDef);
+  CPPUNIT_ASSERT(session != nullptr);
+
+  // The matrix kernels used by TensorFlow depend on the batch size, so the
+  // sums can be done in a different order and the outputs can differ in the
+  // last bits. Accept a relative difference of 1e-5, as in the other tests,
+  // with an absolute floor of 1e-6 for the outputs close to zero.
+  auto almost_equal = [](float a, float b) {
+    return (std::abs(a - b) <= 1e-5 * std::max(std::abs(a), std::abs(b)) + 1e-6);
+  };
+
+  const std::vector<float>* x_tests[10] = {
+    &x_test_0, &x_test_1, &x_test_2, &x_test_3, &x_test_4,
+    &x_test_5, &x_test_6, &x_test_7, &x_test_8, &x_test_9
+  };
+  const int n = 10;
+
+  // All the rows in one batch
+  tensorflow::Tensor batch_input(tensorflow::DT_FLOAT, { n, 36 });
+  float* d = batch_input.flat<float>().data();
+  for (const auto* x : x_tests) {
+    CPPUNIT_ASSERT(x->size() == 36);
+    d = std::copy(x->begin(), x->end(), d);
+  }
+  std::vector<tensorflow::Tensor> batch_outputs;
+  tensorflow::Status status = session->Run({ { "input_1", batch_input } }, { "regr/BiasAdd", "discr/Sigmoid" }, {}, &batch_outputs);
+  CPPUNIT_ASSERT(status.ok());
+  CPPUNIT_ASSERT(batch_outputs.size() == 2);
+
+  // One row at a time
+  for (int i = 0; i < n; ++i) {
+    tensorflow::Tensor input(tensorflow::DT_FLOAT, { 1, 36 });
+    std::copy(x_tests[i]->begin(), x_tests[i]->end(), input.flat<float>().data());
+    std::vector<tensorflow::Tensor> outputs;
+    status = session->Run({ { "input_1", input } }, { "regr/BiasAdd", "discr/Sigmoid" }, {}, &outputs);
+    CPPUNIT_ASSERT(status.ok());
+    CPPUNIT_ASSERT(outputs.size() == 2);
+
+    CPPUNIT_ASSERT(almost_equal(batch_outputs[0].matrix<float>()(i, 0), outputs[0].matrix<float>()(0, 0)) );
+    CPPUNIT_ASSERT(almost_equal(batch_outputs[1].matrix<float>()(i, 0), outputs[1].matrix<float>()(0, 0)) );
+  }
+
+  // cleanup
+  CPPUNIT_ASSERT(tensorflow::closeSession(session));
+  delete graphDef;
+}